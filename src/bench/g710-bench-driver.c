@@ -0,0 +1,214 @@
+/*
+ *  Logitech G710+ driver benchmark, driver side
+ *
+ *  Builds hid-lg-g710-plus.c against the userspace kernel shim of src/fuzz
+ *  and sets up a bound keyboard whose handlers g710-bench.cpp calls. The
+ *  macro keys and the led reports live on the same virtual interface, the
+ *  led reports are answered like GET_REPORT would.
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#include "kernel-shim.h"
+#include "../kernel/hid-lg-g710-plus.c"
+#include "g710-bench.h"
+
+ktime_t shim_now;
+unsigned long jiffies;
+
+void shim_input_event(struct input_dev *dev, unsigned int type, unsigned int code, int value)
+{
+}
+
+struct g710_bench {
+    struct hid_device hdev;
+    struct device interface_dev; /* parent of the sysfs attributes, like the usb interface */
+    struct device attr_dev;
+    struct lg_g710_plus_data *data;
+    struct hid_report keys_report;
+    struct hid_report led_macro_report;
+    struct hid_report led_keys_report;
+    struct hid_field led_macro_field;
+    struct hid_field led_keys_field;
+    s32 led_macro_value[1];
+    s32 led_keys_value[2];
+    struct hid_input hidinput;
+    struct input_dev keyboard;
+    struct hid_field usage_field;
+    struct hid_usage usage;
+};
+
+static const struct device_attribute *g710_bench_attrs[] = {
+    [G710_BENCH_LED_MACRO] = &dev_attr_led_macro,
+    [G710_BENCH_LED_KEYS] = &dev_attr_led_keys,
+    [G710_BENCH_CHORD_MAP] = &dev_attr_chords,
+    [G710_BENCH_TAP_HOLD_MAP] = &dev_attr_tap_hold,
+    [G710_BENCH_REMAP_TABLE] = &dev_attr_remap,
+    [G710_BENCH_NOTIFY] = &dev_attr_notify,
+};
+
+ssize_t g710_bench_store(struct g710_bench *bench, enum g710_bench_attr attr, const char *buf, size_t count)
+{
+    const struct device_attribute *dev_attr = g710_bench_attrs[attr];
+    return dev_attr->store(&bench->attr_dev, (struct device_attribute *)dev_attr, buf, count);
+}
+
+/* Every G key pair (G1+G2 ... G5+G6) sends its own key */
+static int g710_bench_setup_chords(struct g710_bench *bench)
+{
+    char buf[32];
+    int g, len;
+
+    for (g = 0; g + 1 < LOGITECH_G_KEYS; g++) {
+        len= snprintf(buf, sizeof(buf), "%d %d\n", 3 << g, KEY_F13 + g);
+        if (g710_bench_store(bench, G710_BENCH_CHORD_MAP, buf, len) != len) {
+            return -EINVAL;
+        }
+    }
+    chord_mode= true;
+    return 0;
+}
+
+/* G1-G6 send F13-F18 when tapped and F19-F24 when held for 200 ms */
+static int g710_bench_setup_tap_hold(struct g710_bench *bench)
+{
+    char buf[32];
+    int g, len;
+
+    for (g = 0; g < LOGITECH_G_KEYS; g++) {
+        len= snprintf(buf, sizeof(buf), "%d %d %d 200\n", g + 1, KEY_F13 + g, KEY_F19 + g);
+        if (g710_bench_store(bench, G710_BENCH_TAP_HOLD_MAP, buf, len) != len) {
+            return -EINVAL;
+        }
+    }
+    return 0;
+}
+
+/* Every usage of every bank remapped, so that each key goes through the table */
+static int g710_bench_setup_remap(struct g710_bench *bench)
+{
+    size_t size = LOGITECH_REMAP_HEADER_SIZE + LOGITECH_BANKS * LOGITECH_REMAP_USAGES * 2;
+    u8 *blob = calloc(1, size);
+    unsigned int i;
+    ssize_t ret;
+
+    if (blob == NULL) {
+        return -ENOMEM;
+    }
+    memcpy(blob, LOGITECH_REMAP_MAGIC, 4);
+    blob[4]= LOGITECH_REMAP_VERSION;
+    blob[5]= LOGITECH_BANKS;
+    for (i = 0; i < LOGITECH_BANKS * LOGITECH_REMAP_USAGES; i++) {
+        blob[LOGITECH_REMAP_HEADER_SIZE + i * 2]= KEY_A + i % 32;
+    }
+    ret= g710_bench_store(bench, G710_BENCH_REMAP_TABLE, (const char *)blob, size);
+    free(blob);
+    return ret == (ssize_t)size ? 0 : -EINVAL;
+}
+
+struct g710_bench *g710_bench_create(unsigned int flags)
+{
+    const struct lg_g710_plus_model *model = &lg_g710_plus_model_g710_plus;
+    struct g710_bench *bench;
+
+    bench= calloc(1, sizeof(struct g710_bench));
+    if (bench == NULL) {
+        return NULL;
+    }
+    chord_mode= false;
+    skip_generic_parsing= false;
+    native_decode= false;
+
+    bench->keys_report.id= model->keys_report_id;
+    bench->keys_report.type= HID_INPUT_REPORT;
+    bench->hdev.report_enum[HID_INPUT_REPORT].report_id_hash[model->keys_report_id]= &bench->keys_report;
+    bench->interface_dev.driver_data= &bench->hdev;
+    bench->attr_dev.parent= &bench->interface_dev;
+
+    bench->data= lg_g710_plus_create(&bench->hdev, &lg_g710_plus_devices[0]);
+    if (bench->data == NULL) {
+        free(bench);
+        return NULL;
+    }
+    hid_set_drvdata(&bench->hdev, bench->data);
+    if (lg_g710_plus_create_input(&bench->hdev) || bench->data->input_dev == NULL) {
+        g710_bench_destroy(bench);
+        return NULL;
+    }
+
+    bench->led_macro_report.id= model->led_macro_report_id;
+    bench->led_macro_report.type= HID_FEATURE_REPORT;
+    bench->led_macro_report.field[0]= &bench->led_macro_field;
+    bench->led_macro_field.value= bench->led_macro_value;
+    bench->led_keys_report.id= model->led_keys_report_id;
+    bench->led_keys_report.type= HID_FEATURE_REPORT;
+    bench->led_keys_report.field[0]= &bench->led_keys_field;
+    bench->led_keys_field.value= bench->led_keys_value;
+    bench->data->mr_buttons_led_report= &bench->led_macro_report;
+    bench->data->other_buttons_led_report= &bench->led_keys_report;
+    complete_all(&bench->data->initialized);
+
+    bench->hidinput.input= &bench->keyboard;
+    __set_bit(KEY_A, bench->keyboard.keybit); /* as hid-input maps the keyboard page */
+    lg_g710_plus_input_configured(&bench->hdev, &bench->hidinput);
+    bench->usage_field.hidinput= &bench->hidinput;
+    bench->usage.type= EV_KEY;
+
+    if (((flags & G710_BENCH_CHORDS) && g710_bench_setup_chords(bench)) ||
+            ((flags & G710_BENCH_TAP_HOLD) && g710_bench_setup_tap_hold(bench)) ||
+            ((flags & G710_BENCH_REMAP) && g710_bench_setup_remap(bench))) {
+        g710_bench_destroy(bench);
+        return NULL;
+    }
+    return bench;
+}
+
+void g710_bench_destroy(struct g710_bench *bench)
+{
+    struct lg_g710_plus_data *data = bench->data;
+
+    cancel_delayed_work_sync(&data->dim_work);
+    lg_g710_plus_destroy_input(data);
+    lg_g710_plus_shared_put(data->shared);
+    kfree(data);
+    free(bench);
+}
+
+int g710_bench_report(struct g710_bench *bench, uint8_t *data, int size)
+{
+    struct hid_report *report = &bench->keys_report;
+
+    if (data[0] == bench->led_macro_report.id) {
+        report= &bench->led_macro_report;
+    } else if (data[0] == bench->led_keys_report.id) {
+        report= &bench->led_keys_report;
+    }
+    return lg_g710_plus_raw_event(&bench->hdev, report, data, size);
+}
+
+int g710_bench_usage(struct g710_bench *bench, unsigned int usage, int value)
+{
+    bench->usage.hid= HID_UP_KEYBOARD | usage;
+    return lg_g710_plus_event(&bench->hdev, &bench->usage_field, &bench->usage, value);
+}
+
+void g710_bench_advance(struct g710_bench *bench, unsigned int ms)
+{
+    struct hrtimer *timer = &bench->data->key_timer;
+
+    shim_now += ms * NSEC_PER_MSEC;
+    jiffies += ms;
+    if (timer->active && timer->expires <= shim_now) {
+        timer->active= false;
+        if (timer->function(timer) == HRTIMER_RESTART) {
+            timer->active= true;
+        }
+    }
+}
@@ -0,0 +1,235 @@
+/*
+ *  Logitech G710+ driver benchmark
+ *
+ *  Measures the report handlers and the sysfs store functions of
+ *  hid-lg-g710-plus.c without loading the module. The driver is built against
+ *  the userspace kernel shim of src/fuzz (g710-bench-driver.c), so locks,
+ *  timers and the input core cost nothing here: the numbers are the cost of
+ *  the driver code itself. Every benchmark has a realistic input and a worst
+ *  case, e.g. one macro key against all of them changing in one report.
+ *
+ *  Usage: g710-bench [google benchmark options]
+ *    --benchmark_format=json                       print the results as JSON
+ *    --benchmark_out=FILE --benchmark_out_format=json  also save them
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "g710-bench.h"
+
+namespace {
+
+const uint8_t keys_report_id = 3;
+const uint8_t led_macro_report_id = 6;
+const uint8_t led_keys_report_id = 8;
+
+/* Key patterns of report 3, the keyboard sends a report for every change */
+enum key_pattern {
+    key_single, /* G1 pressed and released, as when typing macros */
+    key_all, /* M1-MR and G1-G6 pressed and released together */
+    key_unchanged, /* the same state again, e.g. after a resume */
+};
+
+const char *const key_pattern_names[] = { "single", "all", "unchanged" };
+
+std::vector<std::vector<uint8_t>> key_reports(int pattern)
+{
+    switch (pattern) {
+    case key_single:
+        return { { keys_report_id, 0x01, 0x00 }, { keys_report_id, 0x00, 0x00 } };
+    case key_all:
+        return { { keys_report_id, 0x3f, 0xf0 }, { keys_report_id, 0x00, 0x00 } };
+    default:
+        return { { keys_report_id, 0x01, 0x00 } };
+    }
+}
+
+/* Creates the driver instance of a benchmark, or skips it */
+g710_bench *create(benchmark::State &state, unsigned int flags)
+{
+    g710_bench *bench = g710_bench_create(flags);
+    if (bench == nullptr)
+        state.SkipWithError("cannot set up the driver");
+    return bench;
+}
+
+/* Key diffing and reporting in raw_event, args: pattern, G710_BENCH_* flags */
+void key_report(benchmark::State &state)
+{
+    int pattern = state.range(0);
+    g710_bench *bench = create(state, state.range(1));
+    if (bench == nullptr)
+        return;
+
+    std::vector<std::vector<uint8_t>> reports = key_reports(pattern);
+    size_t i = 0;
+    for (auto _ : state) {
+        std::vector<uint8_t> &report = reports[i];
+        benchmark::DoNotOptimize(g710_bench_report(bench, report.data(), report.size()));
+        i = i + 1 == reports.size() ? 0 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(std::string(key_pattern_names[pattern]) +
+            (state.range(1) & G710_BENCH_CHORDS ? "/chords" : "") +
+            (state.range(1) & G710_BENCH_TAP_HOLD ? "/tap_hold" : ""));
+    g710_bench_destroy(bench);
+}
+
+/* Tap/hold keys held past the threshold, so that the timer reports the hold keys */
+void key_hold(benchmark::State &state)
+{
+    g710_bench *bench = create(state, G710_BENCH_TAP_HOLD);
+    if (bench == nullptr)
+        return;
+
+    uint8_t press[] = { keys_report_id, 0x3f, 0x00 };
+    uint8_t release[] = { keys_report_id, 0x00, 0x00 };
+    for (auto _ : state) {
+        g710_bench_report(bench, press, sizeof(press));
+        g710_bench_advance(bench, 250);
+        g710_bench_report(bench, release, sizeof(release));
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    g710_bench_destroy(bench);
+}
+
+/* Led feature report decoding, arg: 1 if the state changes with every report */
+void led_report(benchmark::State &state, const std::vector<std::vector<uint8_t>> &changing)
+{
+    g710_bench *bench = create(state, 0);
+    if (bench == nullptr)
+        return;
+
+    std::vector<std::vector<uint8_t>> reports(changing.begin(), changing.begin() + (state.range(0) ? 2 : 1));
+    size_t i = 0;
+    for (auto _ : state) {
+        std::vector<uint8_t> &report = reports[i];
+        benchmark::DoNotOptimize(g710_bench_report(bench, report.data(), report.size()));
+        i = i + 1 == reports.size() ? 0 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(state.range(0) ? "changing" : "unchanged");
+    g710_bench_destroy(bench);
+}
+
+void led_macro_report(benchmark::State &state)
+{
+    led_report(state, { { led_macro_report_id, 0x10 }, { led_macro_report_id, 0xf0 } });
+}
+
+void led_keys_report(benchmark::State &state)
+{
+    led_report(state, { { led_keys_report_id, 4, 4 }, { led_keys_report_id, 0, 1 } });
+}
+
+/* Keyboard usages through the remap layer, arg: G710_BENCH_REMAP or 0 */
+void remap_usage(benchmark::State &state)
+{
+    g710_bench *bench = create(state, state.range(0));
+    if (bench == nullptr)
+        return;
+
+    unsigned int usage = 0x04; /* a */
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(g710_bench_usage(bench, usage, 1));
+        benchmark::DoNotOptimize(g710_bench_usage(bench, usage, 0));
+        usage = usage == 0x27 ? 0x04 : usage + 1; /* a-z, 1-0 */
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    state.SetLabel(state.range(0) ? "remapped" : "no table");
+    g710_bench_destroy(bench);
+}
+
+/* A sysfs write, the realistic value first and the worst case second */
+void store(benchmark::State &state, g710_bench_attr attr, const std::vector<std::string> &values)
+{
+    g710_bench *bench = create(state, 0);
+    if (bench == nullptr)
+        return;
+
+    const std::string &value = values[state.range(0)];
+    for (auto _ : state) {
+        ssize_t ret = g710_bench_store(bench, attr, value.data(), value.size());
+        if (ret != (ssize_t)value.size()) {
+            state.SkipWithError("store failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * value.size());
+    state.SetLabel(state.range(0) ? "worst" : "typical");
+    g710_bench_destroy(bench);
+}
+
+std::string remap_blob(int banks)
+{
+    std::string blob("G7RM\x01\x00\x00\x00", 8);
+    blob[5] = banks;
+    for (int i = 0; i < banks * 256; i++) {
+        blob.push_back(30 + i % 26); /* every usage remapped, KEY_A and up */
+        blob.push_back(0);
+    }
+    return blob;
+}
+
+void store_led_macro(benchmark::State &state)
+{
+    store(state, G710_BENCH_LED_MACRO, { "1\n", "0000000000000000015\n" });
+}
+
+void store_led_keys(benchmark::State &state)
+{
+    store(state, G710_BENCH_LED_KEYS, { "68\n", "0000000000000000255\n" });
+}
+
+void store_chords(benchmark::State &state)
+{
+    store(state, G710_BENCH_CHORD_MAP, { "3 183\n", "0000000063 0000000767\n" });
+}
+
+void store_tap_hold(benchmark::State &state)
+{
+    store(state, G710_BENCH_TAP_HOLD_MAP, { "1 183 184 200\n", "0000000006 0000000767 0000000767 0000065535\n" });
+}
+
+void store_remap(benchmark::State &state)
+{
+    store(state, G710_BENCH_REMAP_TABLE, { remap_blob(1), remap_blob(3) });
+}
+
+/* The same notification again, the leds do not change */
+void store_notify(benchmark::State &state)
+{
+    store(state, G710_BENCH_NOTIFY, { "mail 1 8 60000\n", "build-failed-ci 255 15 4294967295\n" });
+}
+
+}
+
+BENCHMARK(key_report)
+    ->ArgsProduct({ { key_single, key_all, key_unchanged }, { 0 } })
+    ->ArgsProduct({ { key_single, key_all }, { G710_BENCH_CHORDS, G710_BENCH_TAP_HOLD,
+                                               G710_BENCH_CHORDS | G710_BENCH_TAP_HOLD } });
+BENCHMARK(key_hold);
+BENCHMARK(led_macro_report)->Arg(0)->Arg(1);
+BENCHMARK(led_keys_report)->Arg(0)->Arg(1);
+BENCHMARK(remap_usage)->Arg(0)->Arg(G710_BENCH_REMAP);
+BENCHMARK(store_led_macro)->Arg(0)->Arg(1);
+BENCHMARK(store_led_keys)->Arg(0)->Arg(1);
+BENCHMARK(store_chords)->Arg(0)->Arg(1);
+BENCHMARK(store_tap_hold)->Arg(0)->Arg(1);
+BENCHMARK(store_remap)->Arg(0)->Arg(1);
+BENCHMARK(store_notify)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,63 @@
+/*
+ *  Logitech G710+ driver benchmark
+ *
+ *  C interface to a driver instance built against the userspace kernel shim
+ *  of src/fuzz, so that the benchmarks (C++) never see the kernel headers.
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#ifndef G710_BENCH_H
+#define G710_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define G710_BENCH_CHORDS 0x01 /* chord_mode with a chord on every pair of G keys */
+#define G710_BENCH_TAP_HOLD 0x02 /* a hold key on every G key */
+#define G710_BENCH_REMAP 0x04 /* a remap table for every bank */
+
+enum g710_bench_attr {
+    G710_BENCH_LED_MACRO,
+    G710_BENCH_LED_KEYS,
+    G710_BENCH_CHORD_MAP,
+    G710_BENCH_TAP_HOLD_MAP,
+    G710_BENCH_REMAP_TABLE,
+    G710_BENCH_NOTIFY,
+};
+
+struct g710_bench;
+
+/* Binds a virtual G710+ with both the macro key and the led reports, NULL on failure */
+struct g710_bench *g710_bench_create(unsigned int flags);
+void g710_bench_destroy(struct g710_bench *bench);
+
+/* Passes a report to raw_event, data[0] is the report id */
+int g710_bench_report(struct g710_bench *bench, uint8_t *data, int size);
+
+/* Passes a keyboard usage of report 1 to the remap layer */
+int g710_bench_usage(struct g710_bench *bench, unsigned int usage, int value);
+
+/* Writes buf to a sysfs attribute, returns what the store function returned */
+ssize_t g710_bench_store(struct g710_bench *bench, enum g710_bench_attr attr, const char *buf, size_t count);
+
+/* Advances the clock, so that pending tap/hold and chord deadlines expire */
+void g710_bench_advance(struct g710_bench *bench, unsigned int ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
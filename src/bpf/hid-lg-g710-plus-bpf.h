@@ -0,0 +1,18 @@
+/*
+ *  Logitech G710+ HID-BPF program, definitions shared with the loader
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+#ifndef HID_LG_G710_PLUS_BPF_H
+#define HID_LG_G710_PLUS_BPF_H
+
+/* report id + 12 bytes, see info/feature_info */
+#define G710_ENABLE_REPORT_SIZE 13
+
+struct g710_enable_args {
+    unsigned int hid; /* hid device id, the XXXX of 0003:046D:C24D.XXXX */
+    int retval; /* result of the SET_REPORT */
+};
+
+#endif
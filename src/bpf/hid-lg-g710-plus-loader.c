@@ -0,0 +1,170 @@
+/*
+ *  Logitech G710+ HID-BPF loader
+ *
+ *  Attaches the HID-BPF program to every G710+ interface found in sysfs (or
+ *  the ones given on the command line), pins the links below
+ *  /sys/fs/bpf/hid-lg-g710-plus so they stay active after the loader exits,
+ *  and enables the macro keys with feature report 9.
+ *
+ *  Usage: hid-lg-g710-plus-loader [-r] [0003:046D:C24D.XXXX ...]
+ *    -r  remove the pinned programs again
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+
+#include "hid-lg-g710-plus-bpf.h"
+#include "hid-lg-g710-plus.skel.h"
+
+#define PIN_DIR "/sys/fs/bpf/hid-lg-g710-plus"
+#define G710_SYSFS_PREFIX "0003:046D:C24D."
+
+static int bound_to_module(const char *name)
+{
+    char path[PATH_MAX], link[PATH_MAX];
+    ssize_t n;
+
+    snprintf(path, sizeof(path), "/sys/bus/hid/devices/%s/driver", name);
+    n = readlink(path, link, sizeof(link) - 1);
+    if (n <= 0)
+        return 0;
+    link[n] = '\0';
+    return strstr(link, "hid-lg-g710-plus") != NULL;
+}
+
+static int attach(const char *name)
+{
+    struct hid_lg_g710_plus *skel;
+    struct g710_enable_args args = { 0 };
+    struct bpf_link *link;
+    char pin[PATH_MAX];
+    int ret;
+
+    if (bound_to_module(name)) {
+        fprintf(stderr, "%s: bound to the hid-lg-g710-plus module, skipping\n", name);
+        return 0;
+    }
+
+    args.hid = strtoul(name + strlen(G710_SYSFS_PREFIX), NULL, 16);
+
+    skel = hid_lg_g710_plus__open();
+    if (skel == NULL) {
+        fprintf(stderr, "%s: cannot open bpf object\n", name);
+        return -1;
+    }
+    skel->struct_ops.g710_plus->hid_id = args.hid;
+
+    ret = hid_lg_g710_plus__load(skel);
+    if (ret) {
+        fprintf(stderr, "%s: cannot load bpf object: %s\n", name, strerror(-ret));
+        goto out;
+    }
+
+    /* attaching reconnects the device, the descriptor fixup applies on reprobe */
+    link = bpf_map__attach_struct_ops(skel->maps.g710_plus);
+    if (link == NULL) {
+        ret = -errno;
+        fprintf(stderr, "%s: cannot attach: %s\n", name, strerror(-ret));
+        goto out;
+    }
+
+    snprintf(pin, sizeof(pin), PIN_DIR "/%s", name);
+    ret = bpf_link__pin(link, pin);
+    if (ret) {
+        fprintf(stderr, "%s: cannot pin link at %s: %s\n", name, pin, strerror(-ret));
+        bpf_link__destroy(link);
+        goto out;
+    }
+    bpf_link__disconnect(link);
+    bpf_link__destroy(link);
+
+    {
+        LIBBPF_OPTS(bpf_test_run_opts, run,
+                    .ctx_in = &args,
+                    .ctx_size_in = sizeof(args),
+                    .ctx_out = &args,
+                    .ctx_size_out = sizeof(args));
+
+        ret = bpf_prog_test_run_opts(bpf_program__fd(skel->progs.g710_enable_macro_keys), &run);
+        /* the interface without feature reports rejects report 9, that is expected */
+        if (ret == 0 && args.retval < 0)
+            printf("%s: attached (no macro key feature report)\n", name);
+        else
+            printf("%s: attached\n", name);
+    }
+
+out:
+    hid_lg_g710_plus__destroy(skel);
+    return ret;
+}
+
+static int detach(const char *name)
+{
+    char pin[PATH_MAX];
+
+    snprintf(pin, sizeof(pin), PIN_DIR "/%s", name);
+    if (unlink(pin) && errno != ENOENT) {
+        fprintf(stderr, "%s: cannot remove %s: %s\n", name, pin, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int (*action)(const char *) = attach;
+    struct dirent *entry;
+    DIR *dir;
+    int i = 1, ret = 0;
+
+    if (argc > 1 && strcmp(argv[1], "-r") == 0) {
+        action = detach;
+        i++;
+    }
+
+    if (action == attach && mkdir(PIN_DIR, 0700) && errno != EEXIST) {
+        fprintf(stderr, "cannot create %s: %s\n", PIN_DIR, strerror(errno));
+        return 1;
+    }
+
+    if (i < argc) {
+        for (; i < argc; i++) {
+            if (strncmp(argv[i], G710_SYSFS_PREFIX, strlen(G710_SYSFS_PREFIX)) != 0) {
+                fprintf(stderr, "%s: not a Logitech G710+ device\n", argv[i]);
+                ret = 1;
+                continue;
+            }
+            ret |= action(argv[i]) != 0;
+        }
+        return ret;
+    }
+
+    dir = opendir("/sys/bus/hid/devices");
+    if (dir == NULL) {
+        perror("/sys/bus/hid/devices");
+        return 1;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, G710_SYSFS_PREFIX, strlen(G710_SYSFS_PREFIX)) == 0)
+            ret |= action(entry->d_name) != 0;
+    }
+    closedir(dir);
+    return ret;
+}
@@ -0,0 +1,150 @@
+/*
+ *  Logitech G710+ HID-BPF program
+ *
+ *  Alternative to the hid-lg-g710-plus module that loads into stock kernels
+ *  (6.11+, struct_ops based HID-BPF). Instead of decoding report 3 by hand in
+ *  raw_event, the vendor defined report 3 is rewritten in the report descriptor
+ *  into keyboard usages, so hid-generic emits F13-F22 for M1-MR and G1-G6
+ *  exactly like g710_plus_key_map does in the module.
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#include "vmlinux.h"
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_tracing.h>
+
+#include "hid-lg-g710-plus-bpf.h"
+
+#define HID_MAX_DESCRIPTOR_SIZE 4096
+#define RDESC_MASK (HID_MAX_DESCRIPTOR_SIZE - 1)
+
+extern __u8 *hid_bpf_get_data(struct hid_bpf_ctx *ctx, unsigned int offset, const size_t __sz) __ksym;
+extern struct hid_bpf_ctx *hid_bpf_allocate_context(unsigned int hid_id) __ksym;
+extern void hid_bpf_release_context(struct hid_bpf_ctx *ctx) __ksym;
+extern int hid_bpf_hw_request(struct hid_bpf_ctx *ctx, __u8 *data, size_t buf__sz,
+                              enum hid_report_type type, enum hid_class_request reqtype) __ksym;
+
+/*
+ * Replacement for the body of report 3. Bit layout is the one the module
+ * decodes: data[1] bits 0-5 are G1-G6, data[2] bits 4-7 are M1-MR.
+ * Push/Pop keep the global state of the rest of the descriptor untouched.
+ */
+static const __u8 g710_report3_rdesc[] = {
+    0xa4,                   /* Push */
+    0x05, 0x07,             /* Usage Page (Keyboard) */
+    0x15, 0x00,             /* Logical Minimum (0) */
+    0x25, 0x01,             /* Logical Maximum (1) */
+    0x75, 0x01,             /* Report Size (1) */
+    0x19, 0x6c, 0x29, 0x71, /* Usage (F17) - Usage (F22): G1-G6 */
+    0x95, 0x06, 0x81, 0x02, /* Report Count (6), Input (Data,Var,Abs) */
+    0x95, 0x06, 0x81, 0x03, /* Report Count (6), Input (Const,Var,Abs) */
+    0x19, 0x68, 0x29, 0x6b, /* Usage (F13) - Usage (F16): M1-MR */
+    0x95, 0x04, 0x81, 0x02, /* Report Count (4), Input (Data,Var,Abs) */
+    0x95, 0x08, 0x81, 0x03, /* Report Count (8), Input (Const,Var,Abs) */
+    0xb4,                   /* Pop */
+};
+
+/* Scratch space for moving the tail of the descriptor, too big for the stack */
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, __u8[HID_MAX_DESCRIPTOR_SIZE]);
+} rdesc_scratch SEC(".maps");
+
+static __always_inline int item_size(__u8 prefix)
+{
+    return (prefix & 3) == 3 ? 4 : (prefix & 3);
+}
+
+SEC("struct_ops/hid_rdesc_fixup")
+int BPF_PROG(g710_rdesc_fixup, struct hid_bpf_ctx *hctx)
+{
+    __u8 *rdesc = hid_bpf_get_data(hctx, 0, HID_MAX_DESCRIPTOR_SIZE);
+    __u8 *scratch;
+    __u32 key = 0, size = hctx->size;
+    __u32 pos = 0, start = 0, end = 0, globals = 0, tail, new_size, i, j;
+    __u8 prefix;
+
+    if (rdesc == NULL || size > HID_MAX_DESCRIPTOR_SIZE)
+        return 0;
+    scratch = bpf_map_lookup_elem(&rdesc_scratch, &key);
+    if (scratch == NULL)
+        return 0;
+
+    /*
+     * Find the items that belong to report 3: everything after "Report ID (3)"
+     * up to the next report id or end of collection. Global items found on the
+     * way are saved, they are re-applied after the replacement.
+     */
+    for (i = 0; i < HID_MAX_DESCRIPTOR_SIZE && pos < size; i++) {
+        prefix = rdesc[pos & RDESC_MASK];
+        if (prefix == 0xfe)
+            return 0; /* long items are never used by the G710+ */
+
+        if (start == 0) {
+            if (prefix == 0x85 && rdesc[(pos + 1) & RDESC_MASK] == 3)
+                start = pos + 2;
+        } else if ((prefix & 0xfc) == 0x84 || prefix == 0xc0) {
+            end = pos;
+            break;
+        } else if (((prefix >> 2) & 3) == 1) {
+            for (j = 0; j < 5 && j <= (__u32)item_size(prefix); j++)
+                scratch[(globals + j) & RDESC_MASK] = rdesc[(pos + j) & RDESC_MASK];
+            globals += item_size(prefix) + 1;
+        }
+        pos += item_size(prefix) + 1;
+    }
+    if (start == 0 || end == 0)
+        return 0; /* not the interface with the macro keys */
+
+    new_size = size - (end - start) + sizeof(g710_report3_rdesc) + globals;
+    if (new_size > HID_MAX_DESCRIPTOR_SIZE)
+        return 0;
+
+    tail = size - end;
+    for (i = 0; i < HID_MAX_DESCRIPTOR_SIZE && i < tail; i++)
+        scratch[(globals + i) & RDESC_MASK] = rdesc[(end + i) & RDESC_MASK];
+
+    for (i = 0; i < sizeof(g710_report3_rdesc); i++)
+        rdesc[(start + i) & RDESC_MASK] = g710_report3_rdesc[i];
+
+    for (i = 0; i < HID_MAX_DESCRIPTOR_SIZE && i < globals + tail; i++)
+        rdesc[(start + sizeof(g710_report3_rdesc) + i) & RDESC_MASK] = scratch[i & RDESC_MASK];
+
+    return new_size;
+}
+
+/*
+ * Writing feature report 9 enables the G1-G6 and M1-MR keys, the same thing
+ * lg_g710_plus_initialize() does. Run by the loader after attaching.
+ */
+SEC("syscall")
+int g710_enable_macro_keys(struct g710_enable_args *args)
+{
+    __u8 buf[G710_ENABLE_REPORT_SIZE] = { 9 };
+    struct hid_bpf_ctx *ctx;
+
+    ctx = hid_bpf_allocate_context(args->hid);
+    if (ctx == NULL)
+        return -1;
+
+    args->retval = hid_bpf_hw_request(ctx, buf, sizeof(buf), HID_FEATURE_REPORT, HID_REQ_SET_REPORT);
+    hid_bpf_release_context(ctx);
+    return 0;
+}
+
+SEC(".struct_ops.link")
+struct hid_bpf_ops g710_plus = {
+    .hid_rdesc_fixup = (void *)g710_rdesc_fixup,
+};
+
+char _license[] SEC("license") = "GPL";
@@ -0,0 +1,46 @@
+#!/bin/sh
+#
+# Writes the seed corpus of g710-fuzz into the given directory: the reports
+# recorded in info/keypresses, one input per report and one input with all of
+# them in every configuration the harness knows, plus led state answers and
+# a profile with every section but the remap table.
+#
+# Usage: g710-fuzz-seeds.sh keypresses corpus_dir
+
+set -e
+
+keypresses=$1
+corpus=$2
+mkdir -p "$corpus"
+
+# "data: 3 1 0 0  <-- G1 Button Press" -> length byte and report bytes as octal escapes
+records=$(awk 'function hex(s,    v, i) {
+        v = 0;
+        for (i = 1; i <= length(s); i++) v = v * 16 + index("0123456789abcdef", tolower(substr(s, i, 1))) - 1;
+        return v;
+    }
+    /Raw event:.*data:/ {
+        sub(/.*data: */, ""); sub(/ *<--.*/, "");
+        n = split($0, b, " ");
+        printf "\\%03o", n;
+        for (i = 1; i <= n; i++) printf "\\%03o", hex(b[i]);
+        printf "\n";
+    }' "$keypresses")
+
+i=0
+for record in $records; do
+    printf "\000$record" > "$corpus/report-$i"
+    i=$((i + 1))
+done
+
+# release, 10 ms, ... between the reports, so the timers get to run
+all=$(for record in $records; do printf '%s\\000\\012' "$record"; done)
+for flags in 000 001 002 005 011 015 020; do
+    printf "\\$flags$all" > "$corpus/keypresses-$flags"
+done
+
+printf '\000\002\006\020' > "$corpus/led-macro"
+printf '\000\003\010\002\004' > "$corpus/led-keys"
+
+# leds, a G1+G2 chord, tap/hold on G1 and dimming after 60 s
+printf '\100G7PF\001\000\000\000\002\000\002\000\005\104\003\000\004\000\003\000\267\000\004\000\010\000\001\000\150\000\151\000\310\000\005\000\002\000\074\000' > "$corpus/profile"
@@ -0,0 +1,196 @@
+/*
+ *  Logitech G710+ report handler fuzzer
+ *
+ *  Builds hid-lg-g710-plus.c against kernel-shim.h and feeds it reports the
+ *  way hid-core would, each one in a buffer of exactly its size so the
+ *  sanitizers catch every read past the end. An input is a configuration byte
+ *  followed by records:
+ *
+ *    byte 0   bit 0 chord_mode, bit 1 skip_generic_parsing, bit 2 G1+G2 chord,
+ *             bit 3 tap/hold on G1, bit 4 native_decode, bit 6: the rest of the
+ *             input is a profile blob for the profile parser, bit 7: the rest of
+ *             the input is a report descriptor for report_fixup instead of records
+ *    records  length n (1-64) and n report bytes starting with the report id,
+ *             or 0 and one byte: advance the clock by that many ms and run the
+ *             expired timers
+ *
+ *  Built with libFuzzer (make) or as a replay program for crash files and
+ *  corpora without it (make replay).
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#include "kernel-shim.h"
+#include "../kernel/hid-lg-g710-plus.c"
+
+#define FUZZ_MAX_REPORT 64
+
+ktime_t shim_now;
+unsigned long jiffies;
+
+/* Reported keys have to be announced, like the input core would require to deliver them */
+void shim_input_event(struct input_dev *dev, unsigned int type, unsigned int code, int value)
+{
+    if (type == EV_KEY && (code > KEY_MAX || !test_bit(code, dev->keybit))) {
+        fprintf(stderr, "key %u reported but not announced\n", code);
+        abort();
+    }
+}
+
+static void fuzz_run_timer(struct hrtimer *timer)
+{
+    if (timer->active && timer->expires <= shim_now) {
+        timer->active= false;
+        if (timer->function(timer) == HRTIMER_RESTART) {
+            timer->active= true;
+        }
+    }
+}
+
+static void fuzz_advance(struct lg_g710_plus_data *data, unsigned int ms)
+{
+    shim_now += ms * NSEC_PER_MSEC;
+    jiffies += ms;
+    fuzz_run_timer(&data->key_timer);
+}
+
+static void fuzz_report(struct hid_device *hdev, const uint8_t *bytes, size_t size)
+{
+    struct hid_report report = { .id = bytes[0], .type = HID_INPUT_REPORT };
+    u8 *buf = malloc(size);
+
+    /* the led state comes back as the answer to GET_REPORT */
+    if (report.id == lg_g710_plus_model_g710_plus.led_macro_report_id ||
+            report.id == lg_g710_plus_model_g710_plus.led_keys_report_id) {
+        report.type= HID_FEATURE_REPORT;
+    }
+    memcpy(buf, bytes, size);
+    lg_g710_plus_raw_event(hdev, &report, buf, size);
+    free(buf);
+}
+
+static void fuzz_rdesc(struct hid_device *hdev, const uint8_t *bytes, size_t size)
+{
+    unsigned int rsize = size;
+    const __u8 *fixed;
+    __u8 *rdesc = malloc(size ? size : 1);
+
+    memcpy(rdesc, bytes, size);
+    fixed= lg_g710_plus_report_fixup(hdev, rdesc, &rsize);
+    if (fixed != rdesc) {
+        free((void *)fixed);
+    }
+    free(rdesc);
+}
+
+/* A profile as written to the profile attribute or loaded as firmware */
+static void fuzz_profile(const uint8_t *bytes, size_t size)
+{
+    struct lg_g710_plus_profile *profile;
+    u8 *blob = malloc(size ? size : 1);
+
+    memcpy(blob, bytes, size);
+    profile= lg_g710_plus_profile_parse(blob, size);
+    if (!IS_ERR(profile)) {
+        lg_g710_plus_profile_free(profile);
+    }
+    free(blob);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *input, size_t size)
+{
+    static struct hid_report keys_report = { .id = 3, .type = HID_INPUT_REPORT };
+    struct hid_device hdev;
+    struct lg_g710_plus_data *data;
+    size_t pos, len;
+    u8 flags;
+
+    if (size < 1) {
+        return 0;
+    }
+    flags= input[0];
+    chord_mode= flags & 0x01;
+    skip_generic_parsing= flags & 0x02;
+    native_decode= flags & 0x10;
+
+    memset(&hdev, 0, sizeof(hdev));
+    hdev.report_enum[HID_INPUT_REPORT].report_id_hash[keys_report.id]= &keys_report;
+    data= lg_g710_plus_create(&hdev, &lg_g710_plus_devices[0]);
+    if (data == NULL) {
+        return 0;
+    }
+    hid_set_drvdata(&hdev, data);
+
+    if (flags & 0x80) {
+        fuzz_rdesc(&hdev, input + 1, size - 1);
+        goto out;
+    }
+    if (flags & 0x40) {
+        fuzz_profile(input + 1, size - 1);
+        goto out;
+    }
+    if (lg_g710_plus_create_input(&hdev)) {
+        goto out;
+    }
+
+    if (data->input_dev != NULL && (flags & 0x04)) {
+        data->chord_map[0x3]= KEY_F23;
+        lg_g710_plus_chord_members_update(data);
+    }
+    if (data->input_dev != NULL && (flags & 0x08)) {
+        data->hold_code[0]= KEY_F24;
+        data->hold_threshold_ms[0]= 200;
+    }
+
+    for (pos = 1; pos < size; pos += len) {
+        len= input[pos++];
+        if (len == 0) {
+            if (pos < size) {
+                fuzz_advance(data, input[pos]);
+            }
+            len= 1;
+        } else if (len <= FUZZ_MAX_REPORT && pos + len <= size) {
+            fuzz_report(&hdev, input + pos, len);
+        } else {
+            break;
+        }
+    }
+
+out:
+    cancel_delayed_work_sync(&data->dim_work);
+    lg_g710_plus_destroy_input(data);
+    lg_g710_plus_shared_put(data->shared);
+    kfree(data);
+    return 0;
+}
+
+#ifdef FUZZ_REPLAY
+/* Runs the inputs given as files once each, for crash files and corpora without libFuzzer */
+int main(int argc, char **argv)
+{
+    static uint8_t buf[1 << 20];
+    size_t size;
+    FILE *f;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        f= fopen(argv[i], "rb");
+        if (f == NULL) {
+            perror(argv[i]);
+            return 1;
+        }
+        size= fread(buf, 1, sizeof(buf), f);
+        fclose(f);
+        LLVMFuzzerTestOneInput(buf, size);
+    }
+    printf("ran %d inputs\n", argc - 1);
+    return 0;
+}
+#endif
@@ -0,0 +1,550 @@
+/*
+ *  Logitech G710+ Keyboard Input Driver
+ *
+ *  Userspace stand-ins for the kernel interfaces hid-lg-g710-plus.c uses, just
+ *  enough to compile the driver into the fuzz harness. Locks, work items and
+ *  the device side do nothing; memory comes from malloc so the sanitizers see
+ *  every access. Timers and the clock are driven by the harness. Every kernel
+ *  header the driver includes is generated by the Makefile and only includes
+ *  this file.
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#ifndef KERNEL_SHIM_H
+#define KERNEL_SHIM_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <linux/types.h>
+#include <linux/input-event-codes.h>
+
+#define LINUX_VERSION_CODE KERNEL_VERSION(6,13,0)
+#define KERNEL_VERSION(a,b,c) (((a) << 16) + ((b) << 8) + (c))
+#define IS_ENABLED(option) 0
+
+typedef __u8 u8;
+typedef __u16 u16;
+typedef __u32 u32;
+typedef __u64 u64;
+typedef __s32 s32;
+typedef __s64 s64;
+typedef s64 ktime_t;
+typedef unsigned long kernel_ulong_t;
+typedef unsigned long dma_addr_t;
+typedef unsigned int gfp_t;
+typedef unsigned short umode_t;
+typedef unsigned int __poll_t;
+
+#define __init
+#define __exit
+#define __user
+#define __rcu
+#define ____cacheline_aligned_in_smp __attribute__((aligned(64)))
+
+#define GFP_KERNEL 0
+#define GFP_ATOMIC 1
+#define THIS_MODULE NULL
+#define PAGE_SIZE 4096UL
+#define PAGE_ALIGN(x) (((x) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1))
+#define U8_MAX 0xff
+#define U16_MAX 0xffff
+#define NSEC_PER_SEC 1000000000LL
+#define NSEC_PER_MSEC 1000000LL
+#define HZ 1000
+#define EALREADY 114
+#define ENOTTY 25
+#define EFAULT 14
+#define ENOMEM 12
+#define ENODEV 19
+#define EINVAL 22
+#define EIO 5
+#define ENOENT 2
+#define ENOSPC 28
+#define ERESTARTSYS 512
+
+#define likely(x) (x)
+#define unlikely(x) (x)
+#define READ_ONCE(x) (x)
+#define WRITE_ONCE(x, v) ((x)= (v))
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define container_of(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min_t(t, a, b) ((t)(a) < (t)(b) ? (t)(a) : (t)(b))
+#define max_t(t, a, b) ((t)(a) > (t)(b) ? (t)(a) : (t)(b))
+#define clamp_val(v, lo, hi) min(max(v, lo), hi)
+#define smp_load_acquire(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define smp_wmb() __atomic_thread_fence(__ATOMIC_RELEASE)
+#define ilog2(n) (31 - __builtin_clz(n))
+#define hweight8(w) __builtin_popcount((u8)(w))
+#define hweight16(w) __builtin_popcount((u16)(w))
+#define ffs(x) __builtin_ffs(x)
+#define fls(x) ((x) ? 32 - __builtin_clz(x) : 0)
+#define __ffs(x) ((unsigned long)__builtin_ctzl(x))
+
+#define pr_info(...) ((void)0)
+#define pr_err(...) ((void)0)
+#define hid_err(h, ...) ((void)(h))
+#define hid_warn(h, ...) ((void)(h))
+#define hid_info(h, ...) ((void)(h))
+#define hid_dbg(h, ...) ((void)(h))
+#define dev_err(d, ...) ((void)(d))
+#define dev_warn(d, ...) ((void)(d))
+#define dev_info(d, ...) ((void)(d))
+
+/* strings */
+#define scnprintf(buf, size, ...) min_t(int, snprintf(buf, size, __VA_ARGS__), (size) - 1)
+static inline int kstrtoul(const char *s, unsigned int base, unsigned long *res)
+{
+    char *end;
+    *res= strtoul(s, &end, base);
+    return end == s || (*end != '\0' && *end != '\n') ? -EINVAL : 0;
+}
+static inline int kstrtouint(const char *s, unsigned int base, unsigned int *res)
+{
+    unsigned long v;
+    int ret = kstrtoul(s, base, &v);
+    *res= v;
+    return ret != 0 || v > 0xffffffffUL ? -EINVAL : 0;
+}
+
+/* errors */
+#define MAX_ERRNO 4095
+#define ERR_PTR(e) ((void *)(long)(e))
+#define PTR_ERR(p) ((long)(p))
+#define IS_ERR_OR_NULL(p) ((p) == NULL || IS_ERR(p))
+#define IS_ERR(p) ((unsigned long)(p) >= (unsigned long)-MAX_ERRNO)
+
+/* module */
+#define module_init(fn)
+#define module_exit(fn)
+#define MODULE_LICENSE(x)
+#define MODULE_AUTHOR(x)
+#define MODULE_DESCRIPTION(x)
+#define MODULE_DEVICE_TABLE(type, table)
+#define MODULE_PARM_DESC(name, desc)
+#define module_param(name, type, perm)
+#define charp char *
+struct module;
+
+/* bits */
+#define BIT(nr) (1UL << (nr))
+#define BITS_PER_LONG (sizeof(long) * 8)
+#define BITS_TO_LONGS(n) (((n) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+static inline void __set_bit(long nr, unsigned long *addr) { addr[nr / BITS_PER_LONG] |= 1UL << (nr % BITS_PER_LONG); }
+static inline void set_bit(long nr, unsigned long *addr) { __set_bit(nr, addr); }
+static inline void clear_bit(long nr, unsigned long *addr) { addr[nr / BITS_PER_LONG] &= ~(1UL << (nr % BITS_PER_LONG)); }
+static inline int test_bit(long nr, const unsigned long *addr) { return (addr[nr / BITS_PER_LONG] >> (nr % BITS_PER_LONG)) & 1; }
+
+/* memory */
+static inline void *kzalloc(size_t size, gfp_t flags) { return calloc(1, size); }
+static inline void *kmalloc(size_t size, gfp_t flags) { return malloc(size); }
+static inline void kfree(const void *p) { free((void *)p); }
+static inline void *vmalloc_user(unsigned long size) { return calloc(1, size); }
+static inline void vfree(const void *p) { free((void *)p); }
+struct rcu_head { int unused; };
+#define kfree_rcu(p, field) kfree(p)
+
+/* time: a clock the harness advances */
+extern ktime_t shim_now;
+extern unsigned long jiffies;
+static inline ktime_t ktime_get(void) { return shim_now; }
+static inline s64 ktime_to_ns(ktime_t t) { return t; }
+static inline s64 ktime_to_ms(ktime_t t) { return t / NSEC_PER_MSEC; }
+static inline ktime_t ktime_sub(ktime_t a, ktime_t b) { return a - b; }
+static inline ktime_t ktime_add(ktime_t a, ktime_t b) { return a + b; }
+static inline ktime_t ktime_add_ms(ktime_t t, u64 ms) { return t + (s64)ms * NSEC_PER_MSEC; }
+static inline ktime_t ms_to_ktime(u64 ms) { return (s64)ms * NSEC_PER_MSEC; }
+static inline s64 ktime_us_delta(ktime_t a, ktime_t b) { return (a - b) / 1000; }
+static inline s64 ktime_ms_delta(ktime_t a, ktime_t b) { return (a - b) / NSEC_PER_MSEC; }
+#define ktime_before(a, b) ((a) < (b))
+#define ktime_after(a, b) ((a) > (b))
+static inline unsigned long msecs_to_jiffies(unsigned int ms) { return ms; }
+static inline unsigned int jiffies_to_msecs(unsigned long j) { return j; }
+#define time_after(a, b) ((long)((b) - (a)) < 0)
+#define time_before(a, b) time_after(b, a)
+
+/* locking */
+typedef struct { int unused; } spinlock_t;
+struct mutex { int unused; };
+typedef struct { unsigned int sequence; } seqcount_t;
+#define spin_lock_init(l) ((void)(l))
+#define spin_lock(l) ((void)(l))
+#define spin_unlock(l) ((void)(l))
+#define spin_lock_irqsave(l, flags) ((void)(l), (flags)= 0)
+#define spin_unlock_irqrestore(l, flags) ((void)(l), (void)(flags))
+#define DEFINE_MUTEX(name) struct mutex name
+#define mutex_init(m) ((void)(m))
+#define mutex_lock(m) ((void)(m))
+#define mutex_lock_interruptible(m) ((void)(m), 0)
+#define mutex_unlock(m) ((void)(m))
+#define lockdep_is_held(l) 1
+#define seqcount_init(s) ((s)->sequence= 0)
+#define write_seqcount_begin(s) ((s)->sequence++)
+#define write_seqcount_end(s) ((s)->sequence++)
+#define read_seqcount_begin(s) ((s)->sequence)
+#define read_seqcount_retry(s, seq) ((s)->sequence != (seq))
+#define rcu_read_lock()
+#define rcu_read_unlock()
+#define rcu_dereference(p) (p)
+#define rcu_dereference_protected(p, c) (p)
+#define rcu_assign_pointer(p, v) ((p)= (v))
+
+typedef struct { s64 counter; } atomic64_t;
+static inline void atomic64_inc(atomic64_t *v) { v->counter++; }
+static inline void atomic64_add(s64 i, atomic64_t *v) { v->counter += i; }
+static inline s64 atomic64_read(const atomic64_t *v) { return v->counter; }
+static inline void atomic64_set(atomic64_t *v, s64 i) { v->counter= i; }
+
+struct kref { int refcount; };
+static inline void kref_init(struct kref *k) { k->refcount= 1; }
+static inline void kref_get(struct kref *k) { k->refcount++; }
+static inline int kref_put(struct kref *k, void (*release)(struct kref *))
+{
+    if (--k->refcount == 0) {
+        release(k);
+        return 1;
+    }
+    return 0;
+}
+
+struct completion { int done; };
+#define init_completion(c) ((c)->done= 0)
+#define complete_all(c) ((c)->done= 1)
+#define completion_done(c) ((c)->done)
+#define wait_for_completion(c) ((void)(c))
+#define wait_for_completion_timeout(c, t) ((c)->done)
+#define wait_for_completion_interruptible_timeout(c, t) ((long)(c)->done)
+
+/* lists */
+struct list_head { struct list_head *next, *prev; };
+#define LIST_HEAD(name) struct list_head name = { &(name), &(name) }
+#define list_empty(head) ((head)->next == (head))
+#define list_for_each_entry(pos, head, member) \
+        for (pos = container_of((head)->next, typeof(*pos), member); &pos->member != (head); \
+             pos = container_of(pos->member.next, typeof(*pos), member))
+static inline void INIT_LIST_HEAD(struct list_head *l) { l->next= l->prev= l; }
+static inline void list_add(struct list_head *n, struct list_head *head)
+{
+    n->next= head->next;
+    n->prev= head;
+    head->next->prev= n;
+    head->next= n;
+}
+static inline void list_del(struct list_head *e)
+{
+    e->prev->next= e->next;
+    e->next->prev= e->prev;
+}
+
+/* work items and timers */
+struct work_struct { void (*func)(struct work_struct *); bool pending; };
+#define INIT_WORK(w, f) ((w)->func= (f), (w)->pending= false)
+static inline bool schedule_work(struct work_struct *w) { w->pending= true; return true; }
+static inline bool cancel_work_sync(struct work_struct *w) { w->pending= false; return false; }
+struct workqueue_struct;
+#define system_wq ((struct workqueue_struct *)NULL)
+#define alloc_ordered_workqueue(name, flags) system_wq
+static inline void destroy_workqueue(struct workqueue_struct *wq) {}
+static inline bool queue_work(struct workqueue_struct *wq, struct work_struct *w) { return schedule_work(w); }
+struct delayed_work { struct work_struct work; unsigned long expires; };
+#define INIT_DELAYED_WORK(w, f) (INIT_WORK(&(w)->work, f), (w)->expires= 0)
+static inline bool mod_delayed_work(struct workqueue_struct *wq, struct delayed_work *w, unsigned long delay)
+{
+    bool pending = w->work.pending;
+    w->work.pending= true;
+    w->expires= jiffies + delay;
+    return pending;
+}
+static inline bool cancel_delayed_work(struct delayed_work *w) { return cancel_work_sync(&w->work); }
+static inline bool cancel_delayed_work_sync(struct delayed_work *w) { return cancel_work_sync(&w->work); }
+
+enum hrtimer_restart { HRTIMER_NORESTART, HRTIMER_RESTART };
+enum hrtimer_mode { HRTIMER_MODE_ABS, HRTIMER_MODE_REL };
+#define CLOCK_MONOTONIC 1
+struct hrtimer { enum hrtimer_restart (*function)(struct hrtimer *); ktime_t expires; bool active; };
+static inline void hrtimer_setup(struct hrtimer *t, enum hrtimer_restart (*fn)(struct hrtimer *), int clock, enum hrtimer_mode mode)
+{
+    t->function= fn;
+    t->active= false;
+}
+static inline void hrtimer_start(struct hrtimer *t, ktime_t time, enum hrtimer_mode mode)
+{
+    t->expires= mode == HRTIMER_MODE_REL ? shim_now + time : time;
+    t->active= true;
+}
+static inline void hrtimer_start_range_ns(struct hrtimer *t, ktime_t time, u64 slack, enum hrtimer_mode mode)
+{
+    hrtimer_start(t, time, mode);
+}
+static inline int hrtimer_cancel(struct hrtimer *t) { int was= t->active; t->active= false; return was; }
+static inline int hrtimer_try_to_cancel(struct hrtimer *t) { return hrtimer_cancel(t); }
+static inline bool hrtimer_active(const struct hrtimer *t) { return t->active; }
+
+/* waiting */
+typedef struct { int unused; } wait_queue_head_t;
+#define init_waitqueue_head(w) ((void)(w))
+#define wake_up_interruptible(w) ((void)(w))
+#define wq_has_sleeper(w) ((void)(w), false)
+struct poll_table_struct;
+typedef struct poll_table_struct poll_table;
+#define poll_wait(f, w, p) ((void)(w))
+#define EPOLLIN 0x1
+#define EPOLLRDNORM 0x40
+#define EPOLLERR 0x8
+#define EPOLLHUP 0x10
+
+/* devices, sysfs, debugfs, char devices */
+struct kobject { int unused; };
+struct device { struct kobject kobj; struct device *parent; void *driver_data; const char *name; };
+struct attribute { const char *name; umode_t mode; };
+struct device_attribute {
+    struct attribute attr;
+    ssize_t (*show)(struct device *, struct device_attribute *, char *);
+    ssize_t (*store)(struct device *, struct device_attribute *, const char *, size_t);
+};
+struct attribute_group { const char *name; struct attribute **attrs; };
+#define DEVICE_ATTR(_name, _mode, _show, _store) \
+        struct device_attribute dev_attr_##_name = { .attr = { .name = #_name, .mode = _mode }, .show = _show, .store = _store }
+static inline int sysfs_create_group(struct kobject *k, const struct attribute_group *g) { return 0; }
+static inline void sysfs_remove_group(struct kobject *k, const struct attribute_group *g) {}
+static inline int sysfs_merge_group(struct kobject *k, const struct attribute_group *g) { return 0; }
+static inline void sysfs_unmerge_group(struct kobject *k, const struct attribute_group *g) {}
+static inline void *dev_get_drvdata(const struct device *d) { return d->driver_data; }
+static inline void dev_set_drvdata(struct device *d, void *p) { d->driver_data= p; }
+static inline const char *dev_name(const struct device *d) { return d->name != NULL ? d->name : "0003:046D:C24D.0001"; }
+static inline void *devm_kmalloc(struct device *d, size_t size, gfp_t flags) { return malloc(size); }
+static inline bool device_can_wakeup(struct device *d) { return false; }
+static inline int device_set_wakeup_enable(struct device *d, bool enable) { return 0; }
+static inline void pm_runtime_set_autosuspend_delay(struct device *d, int delay) {}
+
+struct inode { void *i_private; };
+struct file { void *private_data; };
+struct vm_area_struct { unsigned long vm_start, vm_end, vm_pgoff; };
+struct file_operations {
+    struct module *owner;
+    int (*open)(struct inode *, struct file *);
+    int (*release)(struct inode *, struct file *);
+    ssize_t (*read)(struct file *, char __user *, size_t, loff_t *);
+    ssize_t (*write)(struct file *, const char __user *, size_t, loff_t *);
+    loff_t (*llseek)(struct file *, loff_t, int);
+    __poll_t (*poll)(struct file *, poll_table *);
+    long (*unlocked_ioctl)(struct file *, unsigned int, unsigned long);
+    long (*compat_ioctl)(struct file *, unsigned int, unsigned long);
+    int (*mmap)(struct file *, struct vm_area_struct *);
+};
+static inline loff_t noop_llseek(struct file *f, loff_t o, int w) { return 0; }
+static inline long compat_ptr_ioctl(struct file *f, unsigned int c, unsigned long a) { return -ENOTTY; }
+static inline int remap_vmalloc_range(struct vm_area_struct *v, void *addr, unsigned long off) { return 0; }
+static inline unsigned long copy_to_user(void __user *to, const void *from, unsigned long n) { memcpy(to, from, n); return 0; }
+
+struct seq_file { void *private; };
+static inline int seq_printf(struct seq_file *s, const char *fmt, ...) { return 0; }
+static inline int single_open(struct file *f, int (*show)(struct seq_file *, void *), void *data) { return 0; }
+static inline ssize_t seq_read(struct file *f, char __user *b, size_t n, loff_t *p) { return 0; }
+static inline loff_t seq_lseek(struct file *f, loff_t o, int w) { return 0; }
+static inline int single_release(struct inode *i, struct file *f) { return 0; }
+struct dentry;
+static inline struct dentry *debugfs_create_dir(const char *name, struct dentry *parent) { return NULL; }
+static inline struct dentry *debugfs_create_file(const char *name, umode_t mode, struct dentry *parent, void *data,
+                                                 const struct file_operations *fops) { return NULL; }
+static inline void debugfs_remove_recursive(struct dentry *d) {}
+
+struct miscdevice { int minor; const char *name; const struct file_operations *fops; struct device *parent; };
+#define MISC_DYNAMIC_MINOR 255
+static inline int misc_register(struct miscdevice *m) { return 0; }
+static inline void misc_deregister(struct miscdevice *m) {}
+struct ida { int next; };
+#define DEFINE_IDA(name) struct ida name
+static inline int ida_alloc(struct ida *ida, gfp_t flags) { return ida->next++; }
+static inline void ida_free(struct ida *ida, unsigned int id) {}
+
+struct firmware { size_t size; const u8 *data; };
+static inline int request_firmware_direct(const struct firmware **fw, const char *name, struct device *d) { return -ENOENT; }
+static inline void release_firmware(const struct firmware *fw) {}
+
+/* generic netlink: nobody listens */
+struct sk_buff;
+struct net { int unused; };
+static struct net init_net __attribute__((unused));
+struct genl_multicast_group { const char *name; };
+struct genl_family {
+    const char *name;
+    unsigned int version, maxattr;
+    struct module *module;
+    const struct genl_multicast_group *mcgrps;
+    unsigned int n_mcgrps;
+};
+static inline int genl_register_family(struct genl_family *f) { return 0; }
+static inline int genl_unregister_family(const struct genl_family *f) { return 0; }
+static inline bool genl_has_listeners(const struct genl_family *f, struct net *n, unsigned int group) { return false; }
+static inline struct sk_buff *genlmsg_new(size_t size, gfp_t flags) { return NULL; }
+static inline void *genlmsg_put(struct sk_buff *skb, u32 portid, u32 seq, const struct genl_family *f, int flags, u8 cmd) { return NULL; }
+static inline void genlmsg_end(struct sk_buff *skb, void *hdr) {}
+static inline int genlmsg_multicast(const struct genl_family *f, struct sk_buff *skb, u32 portid, unsigned int group, gfp_t flags) { return 0; }
+static inline int nla_put_string(struct sk_buff *skb, int type, const char *s) { return 0; }
+static inline int nla_put_u8(struct sk_buff *skb, int type, u8 v) { return 0; }
+static inline int nla_total_size(int payload) { return payload + 4; }
+static inline void nlmsg_free(struct sk_buff *skb) {}
+
+/* input */
+struct input_id { u16 bustype, vendor, product, version; };
+struct input_dev {
+    const char *name;
+    const char *phys;
+    const char *uniq;
+    struct input_id id;
+    struct device dev;
+    unsigned long evbit[BITS_TO_LONGS(EV_CNT)];
+    unsigned long keybit[BITS_TO_LONGS(KEY_CNT)];
+    int (*open)(struct input_dev *);
+    void (*close)(struct input_dev *);
+};
+void shim_input_event(struct input_dev *dev, unsigned int type, unsigned int code, int value);
+static inline struct input_dev *input_allocate_device(void) { return calloc(1, sizeof(struct input_dev)); }
+static inline void input_free_device(struct input_dev *dev) { free(dev); }
+static inline int input_register_device(struct input_dev *dev) { return 0; }
+static inline void input_unregister_device(struct input_dev *dev) { free(dev); }
+static inline void input_set_capability(struct input_dev *dev, unsigned int type, unsigned int code)
+{
+    __set_bit(type, dev->evbit);
+    if (type == EV_KEY) {
+        __set_bit(code, dev->keybit);
+    }
+}
+static inline void input_event(struct input_dev *dev, unsigned int type, unsigned int code, int value)
+{
+    shim_input_event(dev, type, code, value);
+}
+static inline void input_report_key(struct input_dev *dev, unsigned int code, int value)
+{
+    shim_input_event(dev, EV_KEY, code, !!value);
+}
+static inline void input_sync(struct input_dev *dev) { shim_input_event(dev, EV_SYN, SYN_REPORT, 0); }
+static inline void input_set_timestamp(struct input_dev *dev, ktime_t t) {}
+static inline void input_set_drvdata(struct input_dev *dev, void *data) { dev->dev.driver_data= data; }
+static inline void *input_get_drvdata(struct input_dev *dev) { return dev->dev.driver_data; }
+
+/* usb */
+struct usb_ctrlrequest;
+struct timer_list { int unused; };
+struct urb { int interval; };
+#define USB_DT_INTERFACE 0x04
+#define USB_DT_ENDPOINT 0x05
+#define USB_DT_INTERFACE_SIZE 9
+#define USB_DT_ENDPOINT_SIZE 7
+struct usb_descriptor_header { u8 bLength, bDescriptorType; };
+struct usb_endpoint_descriptor { u8 bLength, bDescriptorType, bEndpointAddress, bmAttributes; u16 wMaxPacketSize; u8 bInterval; };
+struct usb_host_endpoint { struct usb_endpoint_descriptor desc; };
+struct usb_interface_descriptor { u8 bLength, bDescriptorType, bInterfaceNumber, bAlternateSetting, bNumEndpoints; };
+struct usb_host_interface { struct usb_interface_descriptor desc; struct usb_host_endpoint *endpoint; };
+struct usb_interface { struct usb_host_interface *cur_altsetting; struct device dev; };
+struct usb_config_descriptor { u16 wTotalLength; };
+struct usb_host_config { struct usb_config_descriptor desc; };
+enum usb_device_speed { USB_SPEED_UNKNOWN, USB_SPEED_LOW, USB_SPEED_FULL, USB_SPEED_HIGH };
+enum usb_device_state { USB_STATE_NOTATTACHED, USB_STATE_CONFIGURED };
+struct usb_device {
+    enum usb_device_speed speed;
+    enum usb_device_state state;
+    struct device dev;
+    struct usb_host_config *config, *actconfig;
+    char **rawdescriptors;
+};
+#define to_usb_interface(d) container_of(d, struct usb_interface, dev)
+#define interface_to_usbdev(intf) container_of((intf)->dev.parent, struct usb_device, dev)
+#define le16_to_cpu(x) ((u16)(x))
+static inline struct usb_interface *usb_get_intf(struct usb_interface *intf) { return intf; }
+static inline void usb_put_intf(struct usb_interface *intf) {}
+static inline void usb_lock_device(struct usb_device *u) {}
+static inline void usb_unlock_device(struct usb_device *u) {}
+static inline void device_release_driver(struct device *dev) {}
+static inline int device_attach(struct device *dev) { return 0; }
+static inline int usb_endpoint_is_int_in(const struct usb_endpoint_descriptor *e) { return 0; }
+static inline void usb_kill_urb(struct urb *u) {}
+static inline int usb_submit_urb(struct urb *u, gfp_t flags) { return 0; }
+static inline void usb_enable_autosuspend(struct usb_device *u) {}
+
+/* hid */
+#define HID_INPUT_REPORT 0
+#define HID_OUTPUT_REPORT 1
+#define HID_FEATURE_REPORT 2
+#define HID_REPORT_TYPES 3
+#define HID_REQ_GET_REPORT 0x01
+#define HID_REQ_SET_REPORT 0x09
+#define HID_QUIRK_NOGET 0x00000008
+#define HID_CONNECT_DEFAULT 0x3f
+#define HID_CLAIMED_HIDRAW 4
+#define HID_USAGE 0x0000ffff
+#define HID_USAGE_PAGE 0xffff0000
+#define HID_UP_KEYBOARD 0x00070000
+#define BUS_USB 0x03
+#define USB_DIR_IN 0x80
+#define USB_DIR_OUT 0
+#define HID_CONTROL_FIFO_SIZE 256
+#define PROBE_PREFER_ASYNCHRONOUS 1
+
+struct hid_control_fifo { unsigned char dir; struct hid_report *report; char *raw_report; };
+struct hid_output_fifo { struct hid_report *report; char *raw_report; };
+struct hid_usage { unsigned int hid; u16 code; u8 type; };
+struct hid_input { struct list_head list; struct input_dev *input; };
+struct hid_field { struct hid_input *hidinput; s32 *value; };
+struct hid_report { struct list_head list; unsigned int id; int type; struct hid_field *field[1]; };
+struct hid_report_enum { struct list_head report_list; struct hid_report *report_id_hash[256]; };
+struct hid_device {
+    struct device dev;
+    void *driver_data;
+    struct hid_report_enum report_enum[HID_REPORT_TYPES];
+    unsigned long quirks;
+    unsigned int claimed;
+    void *hidraw;
+    u16 bus;
+    u32 vendor, product, version;
+    char name[128];
+    char phys[64];
+    char uniq[64];
+};
+struct hidraw { int open; };
+struct hid_device_id { u16 bus; u32 vendor, product; kernel_ulong_t driver_data; };
+#define HID_USB_DEVICE(ven, prod) .bus = BUS_USB, .vendor = (ven), .product = (prod)
+typedef struct { int event; } pm_message_t;
+struct hid_driver {
+    const char *name;
+    const struct hid_device_id *id_table;
+    int (*raw_event)(struct hid_device *, struct hid_report *, u8 *, int);
+    int (*event)(struct hid_device *, struct hid_field *, struct hid_usage *, __s32);
+    const __u8 *(*report_fixup)(struct hid_device *, __u8 *, unsigned int *);
+    int (*probe)(struct hid_device *, const struct hid_device_id *);
+    void (*remove)(struct hid_device *);
+    int (*resume)(struct hid_device *);
+    int (*reset_resume)(struct hid_device *);
+    int (*input_configured)(struct hid_device *, struct hid_input *);
+    struct { int probe_type; } driver;
+};
+static inline void *hid_get_drvdata(struct hid_device *hdev) { return dev_get_drvdata(&hdev->dev); }
+static inline void hid_set_drvdata(struct hid_device *hdev, void *data) { dev_set_drvdata(&hdev->dev, data); }
+static inline bool hid_is_usb(struct hid_device *hdev) { return false; }
+static inline int hid_parse(struct hid_device *hdev) { return 0; }
+static inline int hid_hw_start(struct hid_device *hdev, unsigned int mask) { return 0; }
+static inline void hid_hw_stop(struct hid_device *hdev) {}
+static inline int hid_hw_open(struct hid_device *hdev) { return 0; }
+static inline void hid_hw_close(struct hid_device *hdev) {}
+static inline void hid_hw_request(struct hid_device *hdev, struct hid_report *report, int reqtype) {}
+static inline int hid_register_driver(struct hid_driver *d) { return 0; }
+static inline void hid_unregister_driver(struct hid_driver *d) {}
+
+#endif
@@ -15,41 +15,273 @@
  */
 
 #include <linux/hid.h>
+#include <linux/hidraw.h>
 #include <linux/input.h>
 #include <linux/device.h>
+#include <linux/debugfs.h>
+#include <linux/err.h>
+#include <linux/firmware.h>
+#include <linux/hrtimer.h>
+#include <linux/idr.h>
+#include <linux/kref.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/poll.h>
+#include <linux/pm_runtime.h>
+#include <linux/rcupdate.h>
+#include <linux/seq_file.h>
+#include <linux/seqlock.h>
+#include <linux/uaccess.h>
 #include <linux/usb.h>
 #include <linux/version.h>
+#include <linux/vmalloc.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+#include <net/genetlink.h>
 
 #include "hid-ids.h"
+#include "hid-lg-g710-plus.h"
 #include "usbhid/usbhid.h"
 
 #define USB_DEVICE_ID_LOGITECH_KEYBOARD_G710_PLUS 0xc24d
 
-// 20 seeconds timeout
+// 20 seeconds timeout, in ms
 #define WAIT_TIME_OUT 20000
 
 #define LOGITECH_KEY_MAP_SIZE 16
 
-static const u8 g710_plus_key_map[LOGITECH_KEY_MAP_SIZE] = {
-    0, /* unused */
-    0, /* unused */
-    0, /* unused */
-    0, /* unused */
-    KEY_F13, /* M1 */
-    KEY_F14, /* M2 */
-    KEY_F15, /* M3 */
-    KEY_F16, /* MR */
-    KEY_F17, /* G1 */
-    KEY_F18, /* G2 */
-    KEY_F19, /* G3 */
-    KEY_F20, /* G4 */
-    KEY_F21, /* G5 */
-    KEY_F22, /* G6 */
-    0, /* unused */
-    0, /* unused */
+/* Most G-keys and banks of any model, the size of the per G-key, chord and bank tables */
+#define LOGITECH_G_KEYS 6
+#define LOGITECH_CHORD_MAP_SIZE (1 << LOGITECH_G_KEYS)
+#define LOGITECH_BANKS 3
+
+/* Remap layer: one keycode per keyboard page usage and bank */
+#define LOGITECH_REMAP_USAGES 256
+#define LOGITECH_REMAP_MAGIC "G7RM"
+#define LOGITECH_REMAP_VERSION 1
+#define LOGITECH_REMAP_HEADER_SIZE 8
+
+/* Idle dimming lowers the backlight by one level per step */
+#define LOGITECH_DIM_STEP_MS 1000
+
+/* Notifications shown on the M1-MR leds, at most this many at a time */
+#define LOGITECH_NOTIFY_SLOTS 8
+#define LOGITECH_NOTIFY_NAME_SIZE 16
+
+/* Bounds of the polling interval override, in ms */
+#define LOGITECH_POLL_INTERVAL_MIN 1
+#define LOGITECH_POLL_INTERVAL_MAX 255
+
+static bool chord_mode;
+module_param(chord_mode, bool, 0644);
+MODULE_PARM_DESC(chord_mode, "Report configured combinations of G-keys as their own key (default: false)");
+
+static bool native_decode;
+module_param(native_decode, bool, 0644);
+MODULE_PARM_DESC(native_decode, "Rewrite the report descriptor so that hid-input decodes the macro keys instead of the driver, applies when the device is bound (default: false)");
+
+static bool event_device;
+module_param(event_device, bool, 0444);
+MODULE_PARM_DESC(event_device, "Create /dev/g710plus-eventsN with an mmap()able ring of macro key and LED records (default: false)");
+
+static bool skip_generic_parsing;
+module_param(skip_generic_parsing, bool, 0644);
+MODULE_PARM_DESC(skip_generic_parsing, "Stop hid-core from parsing the reports 3, 6 and 8 again after the driver handled them, unless hidraw is open (default: false)");
+
+static unsigned int poll_interval_ms;
+module_param(poll_interval_ms, uint, 0644);
+MODULE_PARM_DESC(poll_interval_ms, "Polling interval in ms for the keyboard's interrupt endpoints (1-255), applies when the device is bound. 0 keeps the interval of the device (default: 0)");
+
+static int autosuspend_delay_ms = -1;
+module_param(autosuspend_delay_ms, int, 0644);
+MODULE_PARM_DESC(autosuspend_delay_ms, "Enable USB autosuspend with remote wakeup after this idle time in ms, applies when the device is bound. -1 leaves runtime PM alone (default: -1)");
+
+static char *profile = "hid-lg-g710-plus.bin";
+module_param(profile, charp, 0444);
+MODULE_PARM_DESC(profile, "Profile loaded from /lib/firmware when the device is bound, empty to disable (default: hid-lg-g710-plus.bin)");
+
+static unsigned int chord_window_ms = 50;
+module_param(chord_window_ms, uint, 0644);
+MODULE_PARM_DESC(chord_window_ms, "Time in ms in which all keys of a chord have to go down (default: 50)");
+
+/*
+ * Replacement for the vendor defined items of report 3 in native_decode mode, with the
+ * layout lg_g710_plus_extra_key_event() decodes by hand: data[1] bits 0-5 are G1-G6,
+ * data[2] bits 4-7 are M1-MR. Push/Pop keep the global state of the following reports
+ */
+static const __u8 g710_plus_report3_rdesc[] = {
+    0xa4,                   /* Push */
+    0x05, 0x07,             /* Usage Page (Keyboard) */
+    0x15, 0x00,             /* Logical Minimum (0) */
+    0x25, 0x01,             /* Logical Maximum (1) */
+    0x75, 0x01,             /* Report Size (1) */
+    0x19, 0x6c, 0x29, 0x71, /* Usage (F17) - Usage (F22): G1-G6 */
+    0x95, 0x06, 0x81, 0x02, /* Report Count (6), Input (Data,Var,Abs) */
+    0x95, 0x06, 0x81, 0x03, /* Report Count (6), Input (Const,Var,Abs) */
+    0x19, 0x68, 0x29, 0x6b, /* Usage (F13) - Usage (F16): M1-MR */
+    0x95, 0x04, 0x81, 0x02, /* Report Count (4), Input (Data,Var,Abs) */
+    0x95, 0x08, 0x81, 0x03, /* Report Count (8), Input (Const,Var,Abs) */
+    0xb4,                   /* Pop */
+};
+
+/*
+ * Everything that differs between the supported keyboards. Referenced from driver_data of the
+ * device table, so the event handlers only follow one pointer and adding a model only adds data
+ */
+struct lg_g710_plus_model {
+    const char *input_name; /* name of the macro key input device */
+    u8 keys_report_id; /* input report with the macro key bitmap: data[1] << 8 | data[2] */
+    u8 led_macro_report_id; /* feature report with the M1-MR leds */
+    u8 led_keys_report_id; /* feature report with the two key backlight levels */
+    u8 enable_report_id; /* feature report written once to enable the macro keys, 0 if none */
+    u8 led_macro_shift; /* position of the M1-MR bits in the first byte of led_macro_report_id */
+    u8 led_keys_max; /* highest backlight level */
+    u8 led_keys_wasd; /* field value of the WASD level in led_keys_report_id, byte 1 of the report is value 0 */
+    u8 led_keys_other; /* field value of the level of the other keys */
+    u16 g_keys_mask; /* G-keys in the bitmap, consecutive with G1 lowest, at most LOGITECH_G_KEYS */
+    u16 bank_keys_mask; /* M-keys that select a bank, consecutive with M1 lowest, at most LOGITECH_BANKS */
+    u8 key_map[LOGITECH_KEY_MAP_SIZE]; /* keycode per bit of the bitmap, 0 if unused */
+    const char *key_names[LOGITECH_KEY_MAP_SIZE];
+    const __u8 *keys_rdesc; /* replacement items of keys_report_id for native_decode, NULL if unsupported */
+    unsigned int keys_rdesc_size;
+};
+
+static const struct lg_g710_plus_model lg_g710_plus_model_g710_plus = {
+    .input_name = "Logitech G710+ Macro Keys",
+    .keys_report_id = 3,
+    .led_macro_report_id = 6,
+    .led_keys_report_id = 8,
+    .enable_report_id = 9,
+    .led_macro_shift = 4,
+    .led_keys_max = 4,
+    .led_keys_wasd = 0,
+    .led_keys_other = 1,
+    .g_keys_mask = 0x3F00, /* G1-G6 */
+    .bank_keys_mask = 0x0070, /* M1-M3 */
+    .key_map = {
+        [4] = KEY_F13, /* M1 */
+        [5] = KEY_F14, /* M2 */
+        [6] = KEY_F15, /* M3 */
+        [7] = KEY_F16, /* MR */
+        [8] = KEY_F17, /* G1 */
+        [9] = KEY_F18, /* G2 */
+        [10] = KEY_F19, /* G3 */
+        [11] = KEY_F20, /* G4 */
+        [12] = KEY_F21, /* G5 */
+        [13] = KEY_F22, /* G6 */
+    },
+    .key_names = {
+        [4] = "M1", "M2", "M3", "MR",
+        [8] = "G1", "G2", "G3", "G4", "G5", "G6",
+    },
+    .keys_rdesc = g710_plus_report3_rdesc,
+    .keys_rdesc_size = sizeof(g710_plus_report3_rdesc),
+};
+
+/* Keyboard remap table, replaced as a whole through the remap sysfs attribute */
+struct lg_g710_plus_remap {
+    struct rcu_head rcu;
+    u8 banks; /* number of banks in map, 1 means the same layer for every bank */
+    u16 map[LOGITECH_BANKS][LOGITECH_REMAP_USAGES]; /* keycode per keyboard usage, 0 keeps the usual key */
+};
+
+/* Parsed and validated profile blob, see hid-lg-g710-plus.h */
+struct lg_g710_plus_profile {
+    bool has_remap, has_leds, has_keys, has_dim;
+    struct lg_g710_plus_remap *remap; /* NULL turns remapping off */
+    u8 led_macro;
+    u8 led_keys;
+    u16 chord_map[LOGITECH_CHORD_MAP_SIZE];
+    u16 tap_code[LOGITECH_G_KEYS];
+    u16 hold_code[LOGITECH_G_KEYS];
+    u16 hold_threshold_ms[LOGITECH_G_KEYS];
+    u16 dim_timeout_s;
+};
+
+/* Named notification shown on the M1-MR leds, free while name is empty */
+struct lg_g710_plus_notification {
+    char name[LOGITECH_NOTIFY_NAME_SIZE];
+    u8 priority; /* only the notifications of the highest priority are shown */
+    u8 leds; /* pattern: M1-MR leds lit, binary coded 0 -> 0xF */
+    bool has_timeout;
+    unsigned long expires; /* jiffies, if has_timeout */
+};
+
+/*
+ * Macro keys held right now, for consumers polling at frame rate. Written under key_lock,
+ * read locklessly; kept in a cache line of its own so readers do not share it with the
+ * fields the report path writes
+ */
+struct lg_g710_plus_keys {
+    seqcount_t seq;
+    u64 generation; /* number of key state changes */
+    u16 keys; /* report 3 bitmap */
+} ____cacheline_aligned_in_smp;
+
+/*
+ * State shared by the two interfaces of one keyboard: the macro keys (which select the bank)
+ * and the remap configuration live on one interface, the ordinary keys on the other
+ */
+struct lg_g710_plus_shared {
+    struct list_head list;
+    struct kref kref;
+    struct device *parent; /* USB device both interfaces belong to */
+
+    u8 bank; /* bank selected by the last M1-M3 press, 0-2 */
+    struct lg_g710_plus_remap __rcu *remap;
+    u16 pressed_code[LOGITECH_REMAP_USAGES]; /* remapped keycode reported for each pressed usage, released with the same code */
+
+    unsigned long last_input; /* jiffies of the last input report on either interface */
+    bool dimmed; /* the backlight is dimmed for inactivity */
+    spinlock_t lock; /* protects backlight */
+    struct lg_g710_plus_data *backlight; /* interface with the led reports, while idle dimming is enabled */
+
+    bool autosuspend_changed; /* enable_autosuspend changed the runtime PM policy of the usb device */
+    bool old_wakeup; /* wakeup and autosuspend settings of the usb device at the first bind, restored at the last unbind */
+    bool old_autosuspend;
+    int old_autosuspend_delay;
+};
+
+/*
+ * mmap()able ring of timestamped records, layout in hid-lg-g710-plus.h. Records are published
+ * under key_lock, the consumer only ever advances the tail. Refcounted because an open file
+ * may outlive the device
+ */
+struct lg_g710_plus_ring {
+    struct kref kref;
+    struct miscdevice misc;
+    char name[32];
+    int index;
+    wait_queue_head_t wait;
+    struct g710_ring_header *header; /* vmalloc_user() area, header page followed by the records */
+    struct g710_ring_record *records;
+    u64 head; /* kernel copy of header->head, never read back from userspace */
+    bool disconnected;
+    struct lg_g710_plus_keys keys; /* copy of the key snapshot for G710_IOC_KEYS, outlives the device */
+};
+
+static DEFINE_IDA(lg_g710_plus_ring_ida);
+
+static const struct genl_multicast_group lg_g710_plus_genl_mcgrps[] = {
+    { .name = G710_GENL_MCGRP },
 };
 
+static struct genl_family lg_g710_plus_genl_family = {
+    .name = G710_GENL_NAME,
+    .version = G710_GENL_VERSION,
+    .maxattr = G710_ATTR_MAX,
+    .module = THIS_MODULE,
+    .mcgrps = lg_g710_plus_genl_mcgrps,
+    .n_mcgrps = ARRAY_SIZE(lg_g710_plus_genl_mcgrps),
+};
+
+static LIST_HEAD(lg_g710_plus_shared_list);
+static DEFINE_MUTEX(lg_g710_plus_shared_lock);
+
 /* Convenience macros */
 #define lg_g710_plus_get_data(hdev) \
         ((struct lg_g710_plus_data *)(hid_get_drvdata(hdev)))
@@ -57,129 +289,1701 @@ static const u8 g710_plus_key_map[LOGITECH_KEY_MAP_SIZE] = {
 #define BIT_AT(var,pos) ((var) & (1<<(pos)))
 
 struct lg_g710_plus_data {
+    const struct lg_g710_plus_model *model;
     struct hid_report *g_mr_buttons_support_report; /* Needs to be written to enable G1-G6 and M1-MR keys */
     struct hid_report *mr_buttons_led_report; /* Controls the backlight of M1-MR buttons */
     struct hid_report *other_buttons_led_report; /* Controls the backlight of other buttons */
     struct hid_report *gamemode_report; /* Controls the backlight of other buttons */
 
     u16 macro_button_state; /* Holds the last state of the G1-G6, M1-MR buttons. Required to know which buttons were pressed and which were released */
+    struct lg_g710_plus_keys keys; /* published copy of macro_button_state for the keys attribute */
     struct hid_device *hdev; 
-    struct input_dev *input_dev;
+    struct input_dev *input_dev; /* input device of the macro keys only, separate from the keyboard */
+    char input_phys[64];
     struct attribute_group attr_group;
 
     u8 led_macro; /* state of the M1-MR macro leds as returned by the keyboard ==> binary coded 0 -> 0xF*/
     u8 led_keys; /* state of the WASD key leds as returned by the keyboard  ==> 0 -> 4 */
+    u8 led_macro_base; /* M1-MR leds set through led_macro or a profile, shown without notifications */
+
+    struct mutex notify_lock; /* protects notify and led_macro_base, serializes the report 6 writes */
+    struct lg_g710_plus_notification notify[LOGITECH_NOTIFY_SLOTS];
+    struct delayed_work notify_work; /* removes the expired notifications at the next expiry */
 
-    spinlock_t lock; /* lock for communication with user space */
+    struct mutex lock; /* serializes the led report requests, hid_hw_request() may sleep */
     struct completion ready; /* ready indicator */
+    struct work_struct init_work; /* enables the macro keys and fetches the led state after probe */
+    struct completion initialized; /* done once init_work ran, the led attributes wait for it */
+
+    unsigned int dim_timeout_s; /* idle time before the backlight is dimmed, 0 disables dimming */
+    struct delayed_work dim_work; /* idle check or dimming step, writes the dimmed or restored levels */
+    u8 dim_saved; /* led_keys before dimming started */
+    bool dim_active; /* the levels written differ from dim_saved */
+
+    ktime_t report_time; /* arrival time of the report being handled, taken at raw_event entry */
+    u64 key_reports; /* debug counter: number of report 3 handled */
+    ktime_t last_key_report_time; /* debug counter: arrival time of the last report 3 */
+    ktime_t resume_time; /* time of the last resume, while wake_pending */
+    bool wake_pending; /* no report arrived since the last resume */
+    s64 wake_latency_ns; /* debug counter: time from the last resume to the first report */
+    struct dentry *debugfs_dir;
+
+    atomic64_t key_presses[LOGITECH_KEY_MAP_SIZE]; /* usage counter: number of presses per key */
+    atomic64_t key_hold_ns[LOGITECH_KEY_MAP_SIZE]; /* usage counter: total time each key was held */
+    ktime_t key_press_time[LOGITECH_KEY_MAP_SIZE]; /* arrival time of the report that pressed the key */
+
+    spinlock_t key_lock; /* protects the key state shared between raw_event and key_timer */
+    struct hrtimer key_timer; /* ends the chord window and decides between tap and hold */
+    u16 chord_map[LOGITECH_CHORD_MAP_SIZE]; /* keycode for each combination of G-keys, indexed by the G1-G6 bitmask */
+    u8 chord_members; /* G-keys that are part of a configured chord, only these wait for the chord window */
+    u8 chord_pending; /* G-keys that went down inside the chord window and were not reported yet */
+    ktime_t chord_deadline; /* end of the current chord window */
+    u8 chord_active; /* G-keys that are held as part of the reported chord */
+    u16 chord_code; /* keycode of the reported chord, 0 if released */
+
+    u16 tap_code[LOGITECH_G_KEYS]; /* keycode sent when a G-key is tapped, 0 for the default F17-F22 */
+    u16 hold_code[LOGITECH_G_KEYS]; /* keycode sent when a G-key is held past its threshold, 0 disables tap/hold */
+    u16 hold_threshold_ms[LOGITECH_G_KEYS]; /* time after which a press counts as hold */
+    u8 tap_pending; /* G-keys that are down and not decided yet */
+    ktime_t tap_deadline[LOGITECH_G_KEYS]; /* time at which a pending G-key becomes a hold */
+    u16 hold_active[LOGITECH_G_KEYS]; /* hold keycode reported as pressed, 0 if none */
+
+    bool native_decode; /* report 3 was rewritten by report_fixup and is decoded by hid-input */
+    u8 default_binterval; /* bInterval of the interrupt in endpoint as described by the device, 0 if not usb */
+
+    struct lg_g710_plus_shared *shared; /* state shared with the other interface of the keyboard */
+    struct lg_g710_plus_ring *ring; /* event ring, NULL unless event_device is set */
+};
+
+static struct dentry *lg_g710_plus_debugfs_root;
+static struct workqueue_struct *lg_g710_plus_rebind_wq; /* ordered, rebinds one interface at a time */
+
+/* A usb interface to rebind after its polling interval changed */
+struct lg_g710_plus_rebind {
+    struct work_struct work;
+    struct usb_interface *intf;
+    u8 binterval;
 };
 
 static ssize_t lg_g710_plus_show_led_macro(struct device *device, struct device_attribute *attr, char *buf);
 static ssize_t lg_g710_plus_store_led_macro(struct device *device, struct device_attribute *attr, const char *buf, size_t count);
 static ssize_t lg_g710_plus_show_led_keys(struct device *device, struct device_attribute *attr, char *buf);
 static ssize_t lg_g710_plus_store_led_keys(struct device *device, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t lg_g710_plus_show_chords(struct device *device, struct device_attribute *attr, char *buf);
+static ssize_t lg_g710_plus_store_chords(struct device *device, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t lg_g710_plus_show_tap_hold(struct device *device, struct device_attribute *attr, char *buf);
+static ssize_t lg_g710_plus_store_tap_hold(struct device *device, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t lg_g710_plus_store_remap(struct device *device, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t lg_g710_plus_show_poll_interval(struct device *device, struct device_attribute *attr, char *buf);
+static ssize_t lg_g710_plus_show_dim_timeout(struct device *device, struct device_attribute *attr, char *buf);
+static ssize_t lg_g710_plus_store_profile(struct device *device, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t lg_g710_plus_show_keys(struct device *device, struct device_attribute *attr, char *buf);
+static ssize_t lg_g710_plus_store_dim_timeout(struct device *device, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t lg_g710_plus_store_poll_interval(struct device *device, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t lg_g710_plus_show_notify(struct device *device, struct device_attribute *attr, char *buf);
+static ssize_t lg_g710_plus_store_notify(struct device *device, struct device_attribute *attr, const char *buf, size_t count);
 
 static DEVICE_ATTR(led_macro, 0660, lg_g710_plus_show_led_macro, lg_g710_plus_store_led_macro);
 static DEVICE_ATTR(led_keys,  0660, lg_g710_plus_show_led_keys,  lg_g710_plus_store_led_keys);
+static DEVICE_ATTR(chords,    0660, lg_g710_plus_show_chords,    lg_g710_plus_store_chords);
+static DEVICE_ATTR(tap_hold,  0660, lg_g710_plus_show_tap_hold,  lg_g710_plus_store_tap_hold);
+static DEVICE_ATTR(remap,     0220, NULL,                        lg_g710_plus_store_remap);
+static DEVICE_ATTR(dim_timeout, 0660, lg_g710_plus_show_dim_timeout, lg_g710_plus_store_dim_timeout);
+static DEVICE_ATTR(profile,   0220, NULL,                        lg_g710_plus_store_profile);
+static DEVICE_ATTR(keys,      0444, lg_g710_plus_show_keys,      NULL);
+static DEVICE_ATTR(poll_interval_ms, 0660, lg_g710_plus_show_poll_interval, lg_g710_plus_store_poll_interval);
+static DEVICE_ATTR(notify,    0660, lg_g710_plus_show_notify,    lg_g710_plus_store_notify);
 
 static struct attribute *lg_g710_plus_attrs[] = {
         &dev_attr_led_macro.attr,
         &dev_attr_led_keys.attr,
+        &dev_attr_chords.attr,
+        &dev_attr_tap_hold.attr,
+        &dev_attr_remap.attr,
+        &dev_attr_dim_timeout.attr,
+        &dev_attr_profile.attr,
+        &dev_attr_keys.attr,
+        &dev_attr_notify.attr,
+        NULL,
+};
+
+/* Added to both usb interfaces, each one has its own interrupt endpoint */
+static struct attribute *lg_g710_plus_usb_attrs[] = {
+        &dev_attr_poll_interval_ms.attr,
         NULL,
 };
 
+static const struct attribute_group lg_g710_plus_usb_attr_group = {
+    .name = "logitech-g710",
+    .attrs = lg_g710_plus_usb_attrs,
+};
+
+/* Called with key_lock held */
+static void lg_g710_plus_keys_publish(struct lg_g710_plus_keys *keys, u16 state)
+{
+    write_seqcount_begin(&keys->seq);
+    keys->generation++;
+    keys->keys= state;
+    write_seqcount_end(&keys->seq);
+}
+
+static void lg_g710_plus_keys_read(const struct lg_g710_plus_keys *keys, struct g710_keys_snapshot *snapshot)
+{
+    unsigned int seq;
+
+    memset(snapshot, 0, sizeof(struct g710_keys_snapshot));
+    do {
+        seq= read_seqcount_begin(&keys->seq);
+        snapshot->generation= keys->generation;
+        snapshot->keys= keys->keys;
+    } while (read_seqcount_retry(&keys->seq, seq));
+}
+
+/* Publishes a record stamped with time into the event ring, if there is one. Called with key_lock held */
+static void lg_g710_plus_ring_publish(struct lg_g710_plus_data *g710_data, ktime_t time, u16 type, u16 value)
+{
+    struct lg_g710_plus_ring *ring = g710_data->ring;
+    struct g710_ring_record *record;
+    u64 tail;
+
+    if (ring == NULL) {
+        return;
+    }
+
+    tail= READ_ONCE(ring->header->tail);
+    if (ring->head - tail >= G710_RING_RECORDS) {
+        ring->header->dropped++; /* full, or a consumer that wrote garbage */
+        return;
+    }
+
+    record= &ring->records[ring->head & (G710_RING_RECORDS - 1)];
+    record->time_ns= ktime_to_ns(time);
+    record->type= type;
+    record->value= value;
+    ring->head++;
+    smp_store_release(&ring->header->head, ring->head);
+
+    if (wq_has_sleeper(&ring->wait)) {
+        wake_up_interruptible(&ring->wait);
+    }
+}
+
+/* Multicasts a state change to the netlink subscribers, if there are any. May be called in atomic context */
+static void lg_g710_plus_genl_send(struct hid_device *hdev, int attr, u8 value)
+{
+    struct sk_buff *skb;
+    void *header;
+
+    if (!genl_has_listeners(&lg_g710_plus_genl_family, &init_net, 0)) {
+        return;
+    }
+
+    skb= genlmsg_new(nla_total_size(strlen(dev_name(&hdev->dev)) + 1) + nla_total_size(sizeof(u8)), GFP_ATOMIC);
+    if (skb == NULL) {
+        return;
+    }
+
+    header= genlmsg_put(skb, 0, 0, &lg_g710_plus_genl_family, 0, G710_CMD_STATE);
+    if (header == NULL || nla_put_string(skb, G710_ATTR_DEVICE, dev_name(&hdev->dev)) || nla_put_u8(skb, attr, value)) {
+        nlmsg_free(skb);
+        return;
+    }
+    genlmsg_end(skb, header);
+    genlmsg_multicast(&lg_g710_plus_genl_family, skb, 0, 0, GFP_ATOMIC);
+}
+
+/*
+ * Return value for a report the driver fully handled. hid-core only passes the report on to
+ * hidraw and the generic field parser if raw_event does not return a negative value
+ */
+static int lg_g710_plus_handled(struct hid_device *hdev)
+{
+    if (!skip_generic_parsing) {
+        return 1;
+    }
+#if IS_ENABLED(CONFIG_HIDRAW)
+    if ((hdev->claimed & HID_CLAIMED_HIDRAW) && hdev->hidraw != NULL && ((struct hidraw *)hdev->hidraw)->open) {
+        return 1; /* somebody reads the raw reports */
+    }
+#endif
+    return -EALREADY;
+}
+
+/*
+ * Ends the frame in the middle of a report, so that a press and the release that follows in the
+ * same report reach userspace as a keystroke. Called with key_lock held
+ */
+static void lg_g710_plus_sync_batch(struct lg_g710_plus_data *g710_data)
+{
+    input_sync(g710_data->input_dev);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,7,0)
+    /* the sync dropped the timestamp, the release and the rest of the batch keep the arrival time */
+    input_set_timestamp(g710_data->input_dev, g710_data->report_time);
+#endif
+}
+
+/* Reports a key of the report 3 bitmap, G-keys with a hold code wait for the tap/hold decision. Called with key_lock held */
+static void lg_g710_plus_report_key(struct lg_g710_plus_data *g710_data, u8 i, bool pressed)
+{
+    u8 g = i - __ffs(g710_data->model->g_keys_mask);
+    u16 code;
+
+    if (!BIT_AT(g710_data->model->g_keys_mask, i)) {
+        input_report_key(g710_data->input_dev, g710_data->model->key_map[i], pressed);
+        return;
+    }
+
+    if (pressed && g710_data->hold_code[g] != 0) {
+        g710_data->tap_pending |= BIT(g);
+        g710_data->tap_deadline[g]= ktime_add_ms(g710_data->key_press_time[i], g710_data->hold_threshold_ms[g]);
+        return;
+    }
+
+    if (!pressed && BIT_AT(g710_data->tap_pending, g)) {
+        /* released before the threshold */
+        code= g710_data->tap_code[g] != 0 ? g710_data->tap_code[g] : g710_data->model->key_map[i];
+        input_report_key(g710_data->input_dev, code, 1);
+        lg_g710_plus_sync_batch(g710_data);
+        input_report_key(g710_data->input_dev, code, 0);
+        g710_data->tap_pending &= ~BIT(g);
+        return;
+    }
+
+    if (!pressed && g710_data->hold_active[g] != 0) {
+        input_report_key(g710_data->input_dev, g710_data->hold_active[g], 0);
+        g710_data->hold_active[g]= 0;
+        return;
+    }
+
+    input_report_key(g710_data->input_dev, g710_data->model->key_map[i], pressed);
+}
+
+/* Starts key_timer for the earliest chord window end or hold threshold, if any. Called with key_lock held */
+static void lg_g710_plus_key_timer_arm(struct lg_g710_plus_data *g710_data)
+{
+    u8 g;
+    bool armed = false;
+    ktime_t next = 0;
+
+    if (g710_data->chord_pending != 0) {
+        next= g710_data->chord_deadline;
+        armed= true;
+    }
+    for (g = 0; g < LOGITECH_G_KEYS; g++) {
+        if (BIT_AT(g710_data->tap_pending, g) && (!armed || ktime_before(g710_data->tap_deadline[g], next))) {
+            next= g710_data->tap_deadline[g];
+            armed= true;
+        }
+    }
+    if (armed) {
+        hrtimer_start(&g710_data->key_timer, next, HRTIMER_MODE_ABS);
+    }
+}
+
+/* Recomputes chord_members after chord_map changed. Called with key_lock held */
+static void lg_g710_plus_chord_members_update(struct lg_g710_plus_data *g710_data)
+{
+    u8 mask;
+
+    g710_data->chord_members= 0;
+    for (mask = 1; mask < LOGITECH_CHORD_MAP_SIZE; mask++) {
+        if (g710_data->chord_map[mask] != 0) {
+            g710_data->chord_members |= mask;
+        }
+    }
+}
+
+/* Reports the G-keys held back in the chord window, as one chord key if the combination is configured. Called with key_lock held */
+static void lg_g710_plus_chord_flush(struct lg_g710_plus_data *g710_data)
+{
+    u8 g;
+    u16 code;
+
+    if (g710_data->chord_pending == 0) {
+        return;
+    }
+
+    code= g710_data->chord_map[g710_data->chord_pending];
+    if (code != 0) {
+        input_report_key(g710_data->input_dev, code, 1);
+        g710_data->chord_active= g710_data->chord_pending;
+        g710_data->chord_code= code;
+    } else {
+        for (g = 0; g < LOGITECH_G_KEYS; g++) {
+            if (BIT_AT(g710_data->chord_pending, g)) {
+                lg_g710_plus_report_key(g710_data, g + __ffs(g710_data->model->g_keys_mask), true);
+            }
+        }
+    }
+    g710_data->chord_pending= 0;
+}
+
+/*
+ * Holds back G-keys of configured chords that go down until the chord window ends or one of
+ * them is released, other G-keys are reported right away. Returns the changed keys that still
+ * have to be reported one by one. Called with key_lock held
+ */
+static u16 lg_g710_plus_chord_event(struct lg_g710_plus_data *g710_data, u16 keys_pressed, u16 changed)
+{
+    u16 g_mask = g710_data->model->g_keys_mask;
+    u8 g_shift = __ffs(g_mask);
+    u8 g_down = (((changed & keys_pressed) & g_mask) >> g_shift) & g710_data->chord_members;
+    u8 g_up = ((changed & ~keys_pressed) & g_mask) >> g_shift;
+
+    if (g_up & g710_data->chord_pending) {
+        /* released before the window ended: decide now, the release follows in its own frame */
+        lg_g710_plus_chord_flush(g710_data);
+        lg_g710_plus_sync_batch(g710_data);
+    }
+
+    if (g_up & g710_data->chord_active) {
+        /* the chord ends with the first of its keys, the others are swallowed until released */
+        if (g710_data->chord_code != 0) {
+            input_report_key(g710_data->input_dev, g710_data->chord_code, 0);
+            g710_data->chord_code= 0;
+        }
+        changed &= ~((u16)(g_up & g710_data->chord_active) << g_shift);
+        g710_data->chord_active &= ~g_up;
+    }
+
+    if (g_down) {
+        if (g710_data->chord_pending == 0) {
+            g710_data->chord_deadline= ktime_add_ms(g710_data->report_time, chord_window_ms);
+        }
+        g710_data->chord_pending |= g_down;
+        changed &= ~((u16)g_down << g_shift);
+    }
+    return changed;
+}
+
+/* Reports the hold code of a pending G-key, it is released with the same code. Called with key_lock held */
+static void lg_g710_plus_hold_start(struct lg_g710_plus_data *g710_data, u8 g)
+{
+    g710_data->hold_active[g]= g710_data->hold_code[g];
+    g710_data->tap_pending &= ~BIT(g);
+    input_report_key(g710_data->input_dev, g710_data->hold_active[g], 1);
+}
+
+/*
+ * Decides the G-keys in mask that are still waiting for the tap/hold decision as held, with the
+ * codes they were pressed with, before their configuration is replaced. Otherwise key_timer
+ * would report the new hold code, or 0. Called with key_lock held
+ */
+static void lg_g710_plus_tap_hold_resolve(struct lg_g710_plus_data *g710_data, u8 mask)
+{
+    u8 g;
+    bool reported = false;
+
+    for (g = 0; g < LOGITECH_G_KEYS; g++) {
+        if (BIT_AT(g710_data->tap_pending & mask, g)) {
+            lg_g710_plus_hold_start(g710_data, g);
+            reported= true;
+        }
+    }
+    if (reported) {
+        input_sync(g710_data->input_dev);
+    }
+}
+
+static enum hrtimer_restart lg_g710_plus_key_timer(struct hrtimer *timer)
+{
+    u8 g;
+    bool reported = false;
+    unsigned long flags;
+    ktime_t now = ktime_get();
+    struct lg_g710_plus_data* g710_data = container_of(timer, struct lg_g710_plus_data, key_timer);
+
+    spin_lock_irqsave(&g710_data->key_lock, flags);
+    if (g710_data->input_dev == NULL) {
+        spin_unlock_irqrestore(&g710_data->key_lock, flags);
+        return HRTIMER_NORESTART; /* being removed */
+    }
+    if (g710_data->chord_pending != 0 && !ktime_before(now, g710_data->chord_deadline)) {
+        lg_g710_plus_chord_flush(g710_data);
+        reported= true;
+    }
+    for (g = 0; g < LOGITECH_G_KEYS; g++) {
+        if (BIT_AT(g710_data->tap_pending, g) && !ktime_before(now, g710_data->tap_deadline[g])) {
+            /* still held at the threshold */
+            lg_g710_plus_hold_start(g710_data, g);
+            reported= true;
+        }
+    }
+    if (reported) {
+        input_sync(g710_data->input_dev);
+    }
+    lg_g710_plus_key_timer_arm(g710_data);
+    spin_unlock_irqrestore(&g710_data->key_lock, flags);
+    return HRTIMER_NORESTART;
+}
+
 static int lg_g710_plus_extra_key_event(struct hid_device *hdev, struct hid_report *report, u8 *data, int size) {
+    u8 i, bank;
+    bool bank_changed;
+    u16 keys_pressed, changed;
+    unsigned long flags;
+    struct lg_g710_plus_data* g710_data = lg_g710_plus_get_data(hdev);
+    if (g710_data != NULL && g710_data->native_decode) {
+        if (size >= 3 && (data[1] << 8 | data[2]) != g710_data->macro_button_state) {
+            g710_data->macro_button_state= data[1] << 8 | data[2];
+            spin_lock_irqsave(&g710_data->key_lock, flags);
+            lg_g710_plus_keys_publish(&g710_data->keys, g710_data->macro_button_state);
+            spin_unlock_irqrestore(&g710_data->key_lock, flags);
+        }
+        return 0; /* decoded by hid-input through the fixed up report descriptor */
+    }
+    if (g710_data == NULL || size < 3) {
+        return 1; /* cannot handle the event */
+    }
+
+    keys_pressed= data[1] << 8 | data[2];
+    changed= keys_pressed ^ g710_data->macro_button_state;
+
+    spin_lock_irqsave(&g710_data->key_lock, flags);
+    if (g710_data->input_dev == NULL) {
+        /* not created yet or already unregistered, the interface is still started */
+        spin_unlock_irqrestore(&g710_data->key_lock, flags);
+        return 1;
+    }
+    for (i = 0; i < LOGITECH_KEY_MAP_SIZE; i++) {
+        if (g710_data->model->key_map[i] != 0 && BIT_AT(changed, i)) {
+            if (BIT_AT(keys_pressed, i)) {
+                atomic64_inc(&g710_data->key_presses[i]);
+                g710_data->key_press_time[i]= g710_data->report_time;
+            } else {
+                atomic64_add(ktime_to_ns(ktime_sub(g710_data->report_time, g710_data->key_press_time[i])), &g710_data->key_hold_ns[i]);
+            }
+        }
+    }
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,7,0)
+    /* stamp the whole batch with the arrival time instead of the input_sync() time */
+    input_set_timestamp(g710_data->input_dev, g710_data->report_time);
+#endif
+    if (chord_mode || g710_data->chord_pending || g710_data->chord_active) {
+        changed= lg_g710_plus_chord_event(g710_data, keys_pressed, changed);
+    }
+
+    for (i = 0; i < LOGITECH_KEY_MAP_SIZE; i++) {
+        if (g710_data->model->key_map[i] != 0 && BIT_AT(changed, i)) {
+            lg_g710_plus_report_key(g710_data, i, BIT_AT(keys_pressed, i) != 0);
+        }
+    }
+    input_sync(g710_data->input_dev);
+
+    bank= READ_ONCE(g710_data->shared->bank);
+    for (i = 0; i < hweight16(g710_data->model->bank_keys_mask); i++) {
+        if (BIT_AT(changed & keys_pressed, i + __ffs(g710_data->model->bank_keys_mask))) {
+            bank= i;
+        }
+    }
+    bank_changed= bank != g710_data->shared->bank;
+    WRITE_ONCE(g710_data->shared->bank, bank);
+
+    if (g710_data->chord_pending || g710_data->tap_pending) {
+        lg_g710_plus_key_timer_arm(g710_data);
+    }
+    lg_g710_plus_ring_publish(g710_data, g710_data->report_time, G710_RECORD_KEYS, keys_pressed);
+    if (keys_pressed != g710_data->macro_button_state) {
+        lg_g710_plus_keys_publish(&g710_data->keys, keys_pressed);
+        if (g710_data->ring != NULL) {
+            lg_g710_plus_keys_publish(&g710_data->ring->keys, keys_pressed);
+        }
+    }
+    spin_unlock_irqrestore(&g710_data->key_lock, flags);
+
+    if (bank_changed) {
+        lg_g710_plus_genl_send(hdev, G710_ATTR_BANK, bank);
+    }
+
+    g710_data->macro_button_state= keys_pressed;
+    g710_data->key_reports++;
+    g710_data->last_key_report_time= g710_data->report_time;
+    return lg_g710_plus_handled(hdev);
+}
+
+/*
+ * Updates the cached led state and tells the event ring and netlink subscribers if it changed.
+ * time is the arrival time of the led report, or ktime_get() when the driver wrote the leds itself
+ */
+static void lg_g710_plus_led_update(struct hid_device *hdev, ktime_t time, u8 *cached, u16 record_type, int attr, u8 value)
+{
+    unsigned long flags;
+    struct lg_g710_plus_data* g710_data = lg_g710_plus_get_data(hdev);
+    if (value != *cached) {
+        spin_lock_irqsave(&g710_data->key_lock, flags);
+        lg_g710_plus_ring_publish(g710_data, time, record_type, value);
+        spin_unlock_irqrestore(&g710_data->key_lock, flags);
+        lg_g710_plus_genl_send(hdev, attr, value);
+    }
+    *cached= value;
+}
+
+static int lg_g710_plus_extra_led_mr_event(struct hid_device *hdev, struct hid_report *report, u8 *data, int size) {
+    struct lg_g710_plus_data* g710_data = lg_g710_plus_get_data(hdev);
+    if (size < 2) {
+        return 0; /* short report, keep the cached state */
+    }
+    lg_g710_plus_led_update(hdev, g710_data->report_time, &g710_data->led_macro, G710_RECORD_LED_MACRO, G710_ATTR_LED_MACRO,
+            (data[1] >> g710_data->model->led_macro_shift) & 0xF);
+    complete_all(&g710_data->ready);
+    return lg_g710_plus_handled(hdev);
+}
+
+static int lg_g710_plus_extra_led_keys_event(struct hid_device *hdev, struct hid_report *report, u8 *data, int size) {
+    struct lg_g710_plus_data* g710_data = lg_g710_plus_get_data(hdev);
+    const struct lg_g710_plus_model *model = g710_data->model;
+    if (size < 2 + max(model->led_keys_wasd, model->led_keys_other)) {
+        return 0; /* short report, keep the cached state */
+    }
+    lg_g710_plus_led_update(hdev, g710_data->report_time, &g710_data->led_keys, G710_RECORD_LED_KEYS, G710_ATTR_LED_KEYS,
+            data[1 + model->led_keys_wasd] << 4 | data[1 + model->led_keys_other]);
+    complete_all(&g710_data->ready);
+    return lg_g710_plus_handled(hdev);
+}
+
+/* Restores the backlight after the first input report that follows dimming. May be called in atomic context */
+static void lg_g710_plus_undim(struct lg_g710_plus_shared *shared)
+{
+    unsigned long flags;
+
+    spin_lock_irqsave(&shared->lock, flags);
+    if (shared->dimmed && shared->backlight != NULL) {
+        shared->dimmed= false;
+        mod_delayed_work(system_wq, &shared->backlight->dim_work, 0);
+    }
+    spin_unlock_irqrestore(&shared->lock, flags);
+}
+
+/*
+ * Keycodes the remap table, chords and tap/hold keys may send: keys only, no buttons, so that
+ * the keyboard is not taken for a mouse or a joystick. 0 means unassigned
+ */
+static bool lg_g710_plus_code_valid(unsigned int code)
+{
+    return code < BTN_MISC || (code >= KEY_OK && code < BTN_DPAD_UP) ||
+        (code > BTN_DPAD_RIGHT && code < BTN_TRIGGER_HAPPY) || (code > BTN_TRIGGER_HAPPY40 && code < KEY_CNT);
+}
+
+/*
+ * Announces every configurable keycode. Must be called before the input device is registered,
+ * keybit is not changed afterwards because events are reported concurrently
+ */
+static void lg_g710_plus_announce_codes(struct input_dev *input)
+{
+    unsigned int code;
+
+    __set_bit(EV_KEY, input->evbit);
+    for (code = KEY_RESERVED + 1; code < KEY_CNT; code++) {
+        if (lg_g710_plus_code_valid(code)) {
+            __set_bit(code, input->keybit);
+        }
+    }
+}
+
+/* Remap layer: replaces keyboard usages by the keycode configured for the current bank */
+static int lg_g710_plus_event(struct hid_device *hdev, struct hid_field *field, struct hid_usage *usage, __s32 value)
+{
+    struct lg_g710_plus_data* data = lg_g710_plus_get_data(hdev);
+    struct lg_g710_plus_shared *shared;
+    struct lg_g710_plus_remap *remap;
+    struct input_dev *input;
+    unsigned int index = usage->hid & HID_USAGE;
+    u16 code = 0;
+
+    if (data == NULL || (usage->hid & HID_USAGE_PAGE) != HID_UP_KEYBOARD || index >= LOGITECH_REMAP_USAGES ||
+            usage->type != EV_KEY || field->hidinput == NULL) {
+        return 0;
+    }
+    shared= data->shared;
+    input= field->hidinput->input;
+
+    /* a held key keeps its code when the bank or the table changes */
+    code= shared->pressed_code[index];
+    if (value && code == 0) {
+        rcu_read_lock();
+        remap= rcu_dereference(shared->remap);
+        if (remap != NULL) {
+            code= remap->map[min_t(u8, READ_ONCE(shared->bank), remap->banks - 1)][index];
+        }
+        rcu_read_unlock();
+    }
+    if (code == 0) {
+        return 0; /* handled by hid-input */
+    }
+
+    if (!test_bit(code, input->keybit)) {
+        return 0; /* not announced by lg_g710_plus_input_configured() */
+    }
+    shared->pressed_code[index]= value ? code : 0;
+    input_event(input, EV_KEY, code, value);
+    return 1;
+}
+
+static int lg_g710_plus_raw_event(struct hid_device *hdev, struct hid_report *report, u8 *data, int size)
+{
+    struct lg_g710_plus_data* g710_data = lg_g710_plus_get_data(hdev);
+    if (g710_data == NULL) {
+        return 0;
+    }
+
+    g710_data->report_time= ktime_get();
+    if (g710_data->wake_pending) {
+        g710_data->wake_latency_ns= ktime_to_ns(ktime_sub(g710_data->report_time, g710_data->resume_time));
+        g710_data->wake_pending= false;
+    }
+    if (report->type == HID_INPUT_REPORT) {
+        WRITE_ONCE(g710_data->shared->last_input, jiffies);
+        if (unlikely(READ_ONCE(g710_data->shared->dimmed))) {
+            lg_g710_plus_undim(g710_data->shared);
+        }
+    }
+    if (report->id == g710_data->model->keys_report_id) {
+        return lg_g710_plus_extra_key_event(hdev, report, data, size);
+    }
+    if (report->id == g710_data->model->led_macro_report_id) {
+        return lg_g710_plus_extra_led_mr_event(hdev, report, data, size);
+    }
+    if (report->id == g710_data->model->led_keys_report_id) {
+        return lg_g710_plus_extra_led_keys_event(hdev, report, data, size);
+    }
+    return 0;
+}
+
+static int lg_g710_plus_stats_show(struct seq_file *s, void *unused)
+{
+    struct lg_g710_plus_data* data = s->private;
+    seq_printf(s, "key_reports: %llu\n", data->key_reports);
+    seq_printf(s, "last_key_report_ns: %lld\n", ktime_to_ns(data->last_key_report_time));
+    seq_printf(s, "wake_latency_ns: %lld\n", data->wake_latency_ns);
+    return 0;
+}
+
+static int lg_g710_plus_stats_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, lg_g710_plus_stats_show, inode->i_private);
+}
+
+static const struct file_operations lg_g710_plus_stats_fops = {
+    .owner = THIS_MODULE,
+    .open = lg_g710_plus_stats_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+static int lg_g710_plus_usage_show(struct seq_file *s, void *unused)
+{
+    struct lg_g710_plus_data* data = s->private;
+    u8 i;
+    for (i = 0; i < LOGITECH_KEY_MAP_SIZE; i++) {
+        if (data->model->key_names[i] != NULL) {
+            seq_printf(s, "%s %lld %lld\n", data->model->key_names[i],
+                    (long long)atomic64_read(&data->key_presses[i]),
+                    (long long)atomic64_read(&data->key_hold_ns[i]));
+        }
+    }
+    return 0;
+}
+
+static int lg_g710_plus_usage_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, lg_g710_plus_usage_show, inode->i_private);
+}
+
+/* Any write resets the usage counters */
+static ssize_t lg_g710_plus_usage_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
+{
+    struct lg_g710_plus_data* data = ((struct seq_file *)file->private_data)->private;
+    u8 i;
+    for (i = 0; i < LOGITECH_KEY_MAP_SIZE; i++) {
+        atomic64_set(&data->key_presses[i], 0);
+        atomic64_set(&data->key_hold_ns[i], 0);
+    }
+    return count;
+}
+
+static const struct file_operations lg_g710_plus_usage_fops = {
+    .owner = THIS_MODULE,
+    .open = lg_g710_plus_usage_open,
+    .read = seq_read,
+    .write = lg_g710_plus_usage_write,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+static void lg_g710_plus_debugfs_init(struct lg_g710_plus_data *data)
+{
+    if (IS_ERR_OR_NULL(lg_g710_plus_debugfs_root)) {
+        return;
+    }
+    data->debugfs_dir= debugfs_create_dir(dev_name(&data->hdev->dev), lg_g710_plus_debugfs_root);
+    debugfs_create_file("stats", 0444, data->debugfs_dir, data, &lg_g710_plus_stats_fops);
+    debugfs_create_file("usage", 0644, data->debugfs_dir, data, &lg_g710_plus_usage_fops);
+}
+
+static unsigned int lg_g710_plus_rdesc_item_size(__u8 prefix)
+{
+    return 1 + ((prefix & 3) == 3 ? 4 : (prefix & 3));
+}
+
+/*
+ * In native_decode mode, replaces the vendor items of report 3 by keyboard usages. Global
+ * items of the replaced part are kept after the replacement, so that the following reports
+ * are parsed exactly as before
+ */
+static __u8 *lg_g710_plus_fixup_rdesc(struct hid_device *hdev, __u8 *rdesc, unsigned int *rsize)
+{
+    unsigned int pos, item, start = 0, end = 0, globals = 0, new_size;
+    struct lg_g710_plus_data* data = lg_g710_plus_get_data(hdev);
+    __u8 *fixed;
+
+    if (!native_decode || data == NULL || data->model->keys_rdesc == NULL) {
+        return rdesc;
+    }
+
+    for (pos = 0; pos < *rsize; pos += item) {
+        item= lg_g710_plus_rdesc_item_size(rdesc[pos]);
+        if (rdesc[pos] == 0xfe || pos + item > *rsize) {
+            return rdesc; /* long items are not used by the G710+ */
+        }
+        if (start == 0) {
+            if (rdesc[pos] == 0x85 && rdesc[pos + 1] == data->model->keys_report_id) {
+                start= pos + item;
+            }
+        } else if ((rdesc[pos] & 0xfc) == 0x84 || rdesc[pos] == 0xc0) {
+            end= pos;
+            break;
+        } else if (((rdesc[pos] >> 2) & 3) == 1) {
+            globals += item;
+        }
+    }
+    if (start == 0 || end == 0) {
+        return rdesc; /* the interface without the macro keys */
+    }
+
+    new_size= *rsize - (end - start) + data->model->keys_rdesc_size + globals;
+    fixed= devm_kmalloc(&hdev->dev, new_size, GFP_KERNEL);
+    if (fixed == NULL) {
+        return rdesc;
+    }
+
+    memcpy(fixed, rdesc, start);
+    memcpy(fixed + start, data->model->keys_rdesc, data->model->keys_rdesc_size);
+    new_size= start + data->model->keys_rdesc_size;
+    for (pos = start; pos < end; pos += item) {
+        item= lg_g710_plus_rdesc_item_size(rdesc[pos]);
+        if (((rdesc[pos] >> 2) & 3) == 1) {
+            memcpy(fixed + new_size, rdesc + pos, item);
+            new_size += item;
+        }
+    }
+    memcpy(fixed + new_size, rdesc + end, *rsize - end);
+    *rsize= new_size + *rsize - end;
+
+    data->native_decode= true;
+    hid_info(hdev, "report %d is decoded by hid-input\n", data->model->keys_report_id);
+    return fixed;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,12,0)
+static const __u8 *lg_g710_plus_report_fixup(struct hid_device *hdev, __u8 *rdesc, unsigned int *rsize)
+#else
+static __u8 *lg_g710_plus_report_fixup(struct hid_device *hdev, __u8 *rdesc, unsigned int *rsize)
+#endif
+{
+    return lg_g710_plus_fixup_rdesc(hdev, rdesc, rsize);
+}
+
+enum req_type {
+    REQTYPE_READ,
+    REQTYPE_WRITE
+};
+
+static void hidhw_request(struct hid_device *hdev, struct hid_report *report, enum req_type reqtype) {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,10,0)
+    hid_hw_request(hdev, report, reqtype == REQTYPE_READ ? HID_REQ_GET_REPORT : HID_REQ_SET_REPORT);
+#else
+    usbhid_submit_report(hdev, report, reqtype == REQTYPE_READ ? USB_DIR_IN : USB_DIR_OUT);
+#endif
+}
+
+/* Runs dim_work again at expires, in jiffies. Idle checks need no precision, the timer wheel is fine */
+static void lg_g710_plus_dim_schedule(struct lg_g710_plus_data *data, unsigned long expires)
+{
+    long delay = (long)(expires - jiffies);
+    mod_delayed_work(system_wq, &data->dim_work, delay > 0 ? delay : 0);
+}
+
+/* Writes the backlight levels, the WASD level in the high nibble of led_keys */
+static void lg_g710_plus_write_led_keys(struct lg_g710_plus_data *data, u8 led_keys)
+{
+    mutex_lock(&data->lock);
+    data->other_buttons_led_report->field[0]->value[data->model->led_keys_wasd]= led_keys >> 4;
+    data->other_buttons_led_report->field[0]->value[data->model->led_keys_other]= led_keys & 0xF;
+    hidhw_request(data->hdev, data->other_buttons_led_report, REQTYPE_WRITE);
+    mutex_unlock(&data->lock);
+}
+
+/*
+ * Runs when the keyboard may have become idle, for every dimming step, and after the first
+ * input report once dimmed. Input reports themselves only store the time
+ */
+static void lg_g710_plus_dim_work(struct work_struct *work)
+{
+    struct lg_g710_plus_data *data = container_of(work, struct lg_g710_plus_data, dim_work.work);
+    struct lg_g710_plus_shared *shared = data->shared;
+    unsigned long timeout = READ_ONCE(data->dim_timeout_s) * HZ;
+    unsigned long last_input = READ_ONCE(shared->last_input);
+    u8 wasd, keys;
+
+    if (timeout == 0 || time_before(jiffies, last_input + timeout)) {
+        WRITE_ONCE(shared->dimmed, false);
+        if (data->dim_active) {
+            lg_g710_plus_write_led_keys(data, data->dim_saved);
+            lg_g710_plus_led_update(data->hdev, ktime_get(), &data->led_keys, G710_RECORD_LED_KEYS, G710_ATTR_LED_KEYS, data->dim_saved);
+            data->dim_active= false;
+        }
+        if (timeout != 0) {
+            lg_g710_plus_dim_schedule(data, last_input + timeout);
+        }
+        return;
+    }
+
+    if (!data->dim_active) {
+        data->dim_saved= data->led_keys;
+        data->dim_active= true;
+    }
+    WRITE_ONCE(shared->dimmed, true);
+
+    wasd= data->led_keys >> 4;
+    keys= data->led_keys & 0xF;
+    if (wasd == 0 && keys == 0) {
+        return; /* fully dimmed, the next input report restarts the timer */
+    }
+    wasd -= wasd > 0;
+    keys -= keys > 0;
+    lg_g710_plus_write_led_keys(data, wasd << 4 | keys);
+    lg_g710_plus_led_update(data->hdev, ktime_get(), &data->led_keys, G710_RECORD_LED_KEYS, G710_ATTR_LED_KEYS, wasd << 4 | keys);
+    lg_g710_plus_dim_schedule(data, jiffies + msecs_to_jiffies(LOGITECH_DIM_STEP_MS));
+}
+
+/* Enables idle dimming after timeout_s, 0 disables it and restores the backlight */
+static void lg_g710_plus_dim_set(struct lg_g710_plus_data *data, unsigned int timeout_s)
+{
+    unsigned long flags;
+
+    WRITE_ONCE(data->dim_timeout_s, timeout_s);
+    spin_lock_irqsave(&data->shared->lock, flags);
+    data->shared->backlight= timeout_s != 0 ? data : NULL;
+    spin_unlock_irqrestore(&data->shared->lock, flags);
+    /* restores the backlight when disabled, otherwise starts waiting for idle */
+    mod_delayed_work(system_wq, &data->dim_work, 0);
+}
+
+/* Stops idle dimming and restores the backlight. Called before the device goes away */
+static void lg_g710_plus_dim_stop(struct lg_g710_plus_data *data)
+{
+    unsigned long flags;
+
+    spin_lock_irqsave(&data->shared->lock, flags);
+    if (data->shared->backlight == data) {
+        data->shared->backlight= NULL;
+    }
+    spin_unlock_irqrestore(&data->shared->lock, flags);
+
+    /* undim no longer finds data and the work does not requeue itself with a timeout of 0 */
+    WRITE_ONCE(data->dim_timeout_s, 0);
+    cancel_delayed_work_sync(&data->dim_work);
+    if (data->dim_active) {
+        lg_g710_plus_write_led_keys(data, data->dim_saved);
+        data->dim_active= false;
+    }
+}
+
+/* M1-MR leds to show: the patterns of the highest priority notifications, led_macro_base without any */
+static u8 lg_g710_plus_notify_compose(struct lg_g710_plus_data *data)
+{
+    int i, top = -1;
+    u8 leds = data->led_macro_base;
+
+    for (i = 0; i < LOGITECH_NOTIFY_SLOTS; i++) {
+        if (data->notify[i].name[0] == '\0' || data->notify[i].priority < top) {
+            continue;
+        }
+        if (data->notify[i].priority > top) {
+            top= data->notify[i].priority;
+            leds= 0;
+        }
+        leds |= data->notify[i].leds;
+    }
+    return leds;
+}
+
+/* Writes the composed M1-MR leds to the keyboard if they differ from its state. Called with notify_lock held */
+static void lg_g710_plus_led_macro_commit(struct lg_g710_plus_data *data)
+{
+    u8 leds = lg_g710_plus_notify_compose(data);
+
+    if (data->mr_buttons_led_report == NULL || leds == data->led_macro) {
+        return; /* no usb transfer when nothing changes */
+    }
+    mutex_lock(&data->lock);
+    data->mr_buttons_led_report->field[0]->value[0]= leds << data->model->led_macro_shift;
+    hidhw_request(data->hdev, data->mr_buttons_led_report, REQTYPE_WRITE);
+    mutex_unlock(&data->lock);
+    lg_g710_plus_led_update(data->hdev, ktime_get(), &data->led_macro, G710_RECORD_LED_MACRO, G710_ATTR_LED_MACRO, leds);
+}
+
+/*
+ * Drops the expired notifications, shows the remaining ones and schedules notify_work for the
+ * next expiry. Called with notify_lock held
+ */
+static void lg_g710_plus_notify_update(struct lg_g710_plus_data *data)
+{
+    int i;
+    bool pending = false;
+    unsigned long now = jiffies, next = 0;
+
+    for (i = 0; i < LOGITECH_NOTIFY_SLOTS; i++) {
+        if (data->notify[i].name[0] == '\0' || !data->notify[i].has_timeout) {
+            continue;
+        }
+        if (!time_before(now, data->notify[i].expires)) {
+            data->notify[i].name[0]= '\0';
+        } else if (!pending || time_before(data->notify[i].expires, next)) {
+            next= data->notify[i].expires;
+            pending= true;
+        }
+    }
+    lg_g710_plus_led_macro_commit(data);
+
+    if (pending) {
+        /* a jiffy late is not visible on the leds */
+        mod_delayed_work(system_wq, &data->notify_work, next - now);
+    } else {
+        /* not _sync, the work takes notify_lock. A run that slips through finds nothing to do */
+        cancel_delayed_work(&data->notify_work);
+    }
+}
+
+static void lg_g710_plus_notify_work(struct work_struct *work)
+{
+    struct lg_g710_plus_data *data = container_of(work, struct lg_g710_plus_data, notify_work.work);
+
+    mutex_lock(&data->notify_lock);
+    lg_g710_plus_notify_update(data);
+    mutex_unlock(&data->notify_lock);
+}
+
+/* Stops the notification expiry. Called before the device goes away, after the attributes are removed */
+static void lg_g710_plus_notify_stop(struct lg_g710_plus_data *data)
+{
+    cancel_delayed_work_sync(&data->notify_work);
+}
+
+/* Parses banks remap layers of 256 little endian keycodes. No banks means no remapping */
+static int lg_g710_plus_remap_parse(const u8 *blob, u8 banks, struct lg_g710_plus_remap **result)
+{
+    unsigned int bank, usage, code;
+    struct lg_g710_plus_remap *remap;
+
+    *result= NULL;
+    if (banks == 0) {
+        return 0;
+    }
+
+    remap= kzalloc(sizeof(struct lg_g710_plus_remap), GFP_KERNEL);
+    if (remap == NULL) {
+        return -ENOMEM;
+    }
+    remap->banks= banks;
+    for (bank = 0; bank < banks; bank++) {
+        for (usage = 0; usage < LOGITECH_REMAP_USAGES; usage++, blob += 2) {
+            code= blob[0] | blob[1] << 8;
+            if (!lg_g710_plus_code_valid(code)) {
+                kfree(remap);
+                return -EINVAL;
+            }
+            remap->map[bank][usage]= code;
+        }
+    }
+    *result= remap;
+    return 0;
+}
+
+static void lg_g710_plus_remap_install(struct lg_g710_plus_shared *shared, struct lg_g710_plus_remap *remap)
+{
+    struct lg_g710_plus_remap *old;
+
+    mutex_lock(&lg_g710_plus_shared_lock);
+    old= rcu_dereference_protected(shared->remap, lockdep_is_held(&lg_g710_plus_shared_lock));
+    rcu_assign_pointer(shared->remap, remap);
+    mutex_unlock(&lg_g710_plus_shared_lock);
+    if (old != NULL)
+        kfree_rcu(old, rcu);
+}
+
+static void lg_g710_plus_profile_free(struct lg_g710_plus_profile *profile)
+{
+    kfree(profile->remap);
+    kfree(profile);
+}
+
+/* Validates a whole profile blob before anything of it is applied */
+static struct lg_g710_plus_profile* lg_g710_plus_profile_parse(const u8 *blob, size_t size)
+{
+    int ret = -EINVAL;
+    size_t pos;
+    unsigned int length, mask, g, code;
+    const u8 *payload;
+    struct lg_g710_plus_profile *profile;
+
+    if (size < sizeof(struct g710_profile_header) || size > G710_PROFILE_MAX_SIZE ||
+            memcmp(blob, G710_PROFILE_MAGIC, 4) != 0 || blob[4] != G710_PROFILE_VERSION) {
+        return ERR_PTR(-EINVAL);
+    }
+
+    profile= kzalloc(sizeof(struct lg_g710_plus_profile), GFP_KERNEL);
+    if (profile == NULL) {
+        return ERR_PTR(-ENOMEM);
+    }
+
+    for (pos = sizeof(struct g710_profile_header); pos < size; pos += sizeof(struct g710_profile_section) + length) {
+        if (size - pos < sizeof(struct g710_profile_section)) {
+            goto err;
+        }
+        length= blob[pos + 2] | blob[pos + 3] << 8;
+        payload= blob + pos + sizeof(struct g710_profile_section);
+        if (size - pos - sizeof(struct g710_profile_section) < length) {
+            goto err;
+        }
+
+        switch (blob[pos]) {
+            case G710_PROFILE_REMAP:
+                if (profile->has_remap || length < 2 || payload[0] > LOGITECH_BANKS ||
+                        length != 2 + payload[0] * LOGITECH_REMAP_USAGES * 2) {
+                    goto err;
+                }
+                ret= lg_g710_plus_remap_parse(payload + 2, payload[0], &profile->remap);
+                if (ret) {
+                    goto err;
+                }
+                ret= -EINVAL;
+                profile->has_remap= true;
+                break;
+            case G710_PROFILE_LEDS:
+                if (length != 2) {
+                    goto err;
+                }
+                profile->led_macro= payload[0] & 0xF;
+                profile->led_keys= payload[1];
+                profile->has_leds= true;
+                break;
+            case G710_PROFILE_CHORD:
+                if (length != 4) {
+                    goto err;
+                }
+                mask= payload[0];
+                code= payload[2] | payload[3] << 8;
+                if (mask == 0 || mask >= LOGITECH_CHORD_MAP_SIZE || !lg_g710_plus_code_valid(code)) {
+                    goto err;
+                }
+                profile->chord_map[mask]= code;
+                profile->has_keys= true;
+                break;
+            case G710_PROFILE_TAP_HOLD:
+                if (length != 8) {
+                    goto err;
+                }
+                g= payload[0];
+                if (g < 1 || g > LOGITECH_G_KEYS) {
+                    goto err;
+                }
+                profile->tap_code[g - 1]= payload[2] | payload[3] << 8;
+                profile->hold_code[g - 1]= payload[4] | payload[5] << 8;
+                profile->hold_threshold_ms[g - 1]= payload[6] | payload[7] << 8;
+                if (!lg_g710_plus_code_valid(profile->tap_code[g - 1]) ||
+                        !lg_g710_plus_code_valid(profile->hold_code[g - 1])) {
+                    goto err;
+                }
+                profile->has_keys= true;
+                break;
+            case G710_PROFILE_DIM:
+                if (length != 2) {
+                    goto err;
+                }
+                profile->dim_timeout_s= payload[0] | payload[1] << 8;
+                profile->has_dim= true;
+                break;
+            default:
+                goto err;
+        }
+    }
+    return profile;
+
+err:
+    lg_g710_plus_profile_free(profile);
+    return ERR_PTR(ret);
+}
+
+/*
+ * Applies a parsed profile. Chords and tap/hold change in one key_lock section, the remap
+ * table with one pointer swap. Takes ownership of the profile. Needs the deferred init done
+ */
+static int lg_g710_plus_profile_apply(struct lg_g710_plus_data *data, struct lg_g710_plus_profile *profile)
+{
+    unsigned long flags;
+
+    if (profile->has_keys && data->input_dev == NULL) {
+        lg_g710_plus_profile_free(profile);
+        return -ENODEV;
+    }
+
+    if (profile->has_keys) {
+        spin_lock_irqsave(&data->key_lock, flags);
+        lg_g710_plus_tap_hold_resolve(data, U8_MAX);
+        memcpy(data->chord_map, profile->chord_map, sizeof(data->chord_map));
+        lg_g710_plus_chord_members_update(data);
+        memcpy(data->tap_code, profile->tap_code, sizeof(data->tap_code));
+        memcpy(data->hold_code, profile->hold_code, sizeof(data->hold_code));
+        memcpy(data->hold_threshold_ms, profile->hold_threshold_ms, sizeof(data->hold_threshold_ms));
+        spin_unlock_irqrestore(&data->key_lock, flags);
+    }
+
+    if (profile->has_remap) {
+        lg_g710_plus_remap_install(data->shared, profile->remap);
+        profile->remap= NULL;
+    }
+
+    if (profile->has_leds) {
+        mutex_lock(&data->notify_lock);
+        data->led_macro_base= profile->led_macro;
+        lg_g710_plus_led_macro_commit(data);
+        mutex_unlock(&data->notify_lock);
+    }
+    if (profile->has_leds && data->other_buttons_led_report != NULL) {
+        profile->led_keys= min_t(u8, profile->led_keys >> 4, data->model->led_keys_max) << 4 |
+                min_t(u8, profile->led_keys & 0xF, data->model->led_keys_max);
+        lg_g710_plus_write_led_keys(data, profile->led_keys);
+        lg_g710_plus_led_update(data->hdev, ktime_get(), &data->led_keys, G710_RECORD_LED_KEYS, G710_ATTR_LED_KEYS, profile->led_keys);
+        data->dim_saved= profile->led_keys;
+    }
+
+    if (profile->has_dim && data->other_buttons_led_report != NULL) {
+        lg_g710_plus_dim_set(data, profile->dim_timeout_s);
+    }
+
+    lg_g710_plus_profile_free(profile);
+    return 0;
+}
+
+/* Loads the profile named by the profile parameter, a missing file is not an error */
+static void lg_g710_plus_profile_load(struct lg_g710_plus_data *data)
+{
+    const struct firmware *fw;
+    struct lg_g710_plus_profile *parsed;
+
+    if (profile == NULL || profile[0] == '\0' || data->input_dev == NULL) {
+        return;
+    }
+    if (request_firmware_direct(&fw, profile, &data->hdev->dev)) {
+        return;
+    }
+
+    parsed= lg_g710_plus_profile_parse(fw->data, fw->size);
+    release_firmware(fw);
+    if (IS_ERR(parsed)) {
+        hid_warn(data->hdev, "invalid profile %s: %ld\n", profile, PTR_ERR(parsed));
+        return;
+    }
+    if (lg_g710_plus_profile_apply(data, parsed) == 0) {
+        hid_info(data->hdev, "applied profile %s\n", profile);
+    }
+}
+
+/*
+ * Runs after probe returned: the SET_REPORT that enables the macro keys and the GET_REPORTs
+ * for the led state each wait for the keyboard, which would otherwise add to boot and hotplug
+ * time. No locking against the led attributes, they wait for this work to finish
+ */
+static void lg_g710_plus_init_work(struct work_struct *work)
+{
+    struct lg_g710_plus_data *data = container_of(work, struct lg_g710_plus_data, init_work);
+    struct hid_report *led_reports[] = { data->mr_buttons_led_report, data->other_buttons_led_report };
+    ktime_t start = ktime_get();
+    int i;
+
+    if (data->g_mr_buttons_support_report != NULL) {
+        hidhw_request(data->hdev, data->g_mr_buttons_support_report, REQTYPE_WRITE);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(led_reports); i++) {
+        if (led_reports[i] != NULL) {
+            init_completion(&data->ready);
+            hidhw_request(data->hdev, led_reports[i], REQTYPE_READ);
+            wait_for_completion_timeout(&data->ready, msecs_to_jiffies(WAIT_TIME_OUT));
+        }
+    }
+    data->led_macro_base= data->led_macro;
+
+    lg_g710_plus_profile_load(data);
+
+    hid_dbg(data->hdev, "deferred init took %lld us\n", ktime_us_delta(ktime_get(), start));
+    complete_all(&data->initialized);
+}
+
+/* Waits for the deferred init before the first access to the led reports */
+static void lg_g710_plus_wait_initialized(struct lg_g710_plus_data *data)
+{
+    wait_for_completion(&data->initialized);
+}
+
+static int lg_g710_plus_initialize(struct hid_device *hdev) {
+    int ret = 0;
+    struct lg_g710_plus_data *data;
+    struct list_head *feature_report_list = &hdev->report_enum[HID_FEATURE_REPORT].report_list;
+    struct hid_report *report;
+
+    data = lg_g710_plus_get_data(hdev);
+    if (list_empty(feature_report_list)) {
+        complete_all(&data->initialized);
+        return 0; /* Currently, the keyboard registers as two different devices */
+    }
+
+    list_for_each_entry(report, feature_report_list, list) {
+        if (report->id == data->model->led_macro_report_id) {
+            data->mr_buttons_led_report= report;
+        } else if (report->id == data->model->led_keys_report_id) {
+            data->other_buttons_led_report= report;
+        } else if (report->id == data->model->enable_report_id) {
+            data->g_mr_buttons_support_report= report;
+        }
+    }
+
+    ret= sysfs_create_group(&hdev->dev.kobj, &data->attr_group);
+    if (ret == 0) {
+        schedule_work(&data->init_work);
+    }
+    return ret;
+}
+
+/* usbhid only polls the interrupt endpoint while the device is open, as hid-input would do */
+static int lg_g710_plus_input_open(struct input_dev *input)
+{
+    return hid_hw_open(input_get_drvdata(input));
+}
+
+static void lg_g710_plus_input_close(struct input_dev *input)
+{
+    hid_hw_close(input_get_drvdata(input));
+}
+
+/*
+ * Registers an input device that only contains the macro keys, so that macro daemons
+ * can grab it without receiving (and waking up for) every other keystroke
+ */
+static int lg_g710_plus_create_input(struct hid_device *hdev)
+{
+    u8 i;
+    int ret;
+    unsigned long flags;
+    struct input_dev *input;
+    struct lg_g710_plus_data *data = lg_g710_plus_get_data(hdev);
+
+    if (hdev->report_enum[HID_INPUT_REPORT].report_id_hash[data->model->keys_report_id] == NULL) {
+        return 0; /* the macro keys are reported by the other interface */
+    }
+    if (data->native_decode) {
+        return 0; /* the macro keys are reported by the keyboard input device */
+    }
+
+    input= input_allocate_device();
+    if (input == NULL) {
+        return -ENOMEM;
+    }
+
+    snprintf(data->input_phys, sizeof(data->input_phys), "%s/macro", hdev->phys);
+    input->name= data->model->input_name;
+    input->phys= data->input_phys;
+    input->uniq= hdev->uniq;
+    input->id.bustype= hdev->bus;
+    input->id.vendor= hdev->vendor;
+    input->id.product= hdev->product;
+    input->id.version= hdev->version;
+    input->dev.parent= &hdev->dev;
+    input->open= lg_g710_plus_input_open;
+    input->close= lg_g710_plus_input_close;
+    input_set_drvdata(input, hdev);
+
+    for (i = 0; i < LOGITECH_KEY_MAP_SIZE; i++) {
+        if (data->model->key_map[i] != 0) {
+            input_set_capability(input, EV_KEY, data->model->key_map[i]);
+        }
+    }
+    lg_g710_plus_announce_codes(input); /* chords and tap/hold keys */
+
+    ret= input_register_device(input);
+    if (ret) {
+        input_free_device(input);
+        return ret;
+    }
+    spin_lock_irqsave(&data->key_lock, flags);
+    data->input_dev= input; /* raw_event already runs */
+    spin_unlock_irqrestore(&data->key_lock, flags);
+    return 0;
+}
+
+/* Unregisters the macro key input device while raw_event may still run */
+static void lg_g710_plus_destroy_input(struct lg_g710_plus_data *data)
+{
+    unsigned long flags;
+    struct input_dev *input;
+
+    spin_lock_irqsave(&data->key_lock, flags);
+    input= data->input_dev;
+    data->input_dev= NULL;
+    spin_unlock_irqrestore(&data->key_lock, flags);
+
+    if (input == NULL) {
+        return;
+    }
+    /* only armed with an input device, neither raw_event nor the timer itself arm it again */
+    hrtimer_cancel(&data->key_timer);
+    input_unregister_device(input);
+}
+
+static void lg_g710_plus_ring_release(struct kref *kref)
+{
+    struct lg_g710_plus_ring *ring = container_of(kref, struct lg_g710_plus_ring, kref);
+    ida_free(&lg_g710_plus_ring_ida, ring->index);
+    vfree(ring->header);
+    kfree(ring);
+}
+
+static int lg_g710_plus_ring_open(struct inode *inode, struct file *file)
+{
+    struct lg_g710_plus_ring *ring = container_of(file->private_data, struct lg_g710_plus_ring, misc);
+    kref_get(&ring->kref);
+    file->private_data= ring;
+    return 0;
+}
+
+static int lg_g710_plus_ring_close(struct inode *inode, struct file *file)
+{
+    struct lg_g710_plus_ring *ring = file->private_data;
+    kref_put(&ring->kref, lg_g710_plus_ring_release);
+    return 0;
+}
+
+static int lg_g710_plus_ring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    struct lg_g710_plus_ring *ring = file->private_data;
+    if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start > PAGE_ALIGN(G710_RING_SIZE)) {
+        return -EINVAL;
+    }
+    return remap_vmalloc_range(vma, ring->header, 0);
+}
+
+static __poll_t lg_g710_plus_ring_poll(struct file *file, poll_table *wait)
+{
+    struct lg_g710_plus_ring *ring = file->private_data;
+    poll_wait(file, &ring->wait, wait);
+    if (READ_ONCE(ring->disconnected)) {
+        return EPOLLHUP | EPOLLERR;
+    }
+    return smp_load_acquire(&ring->header->head) != READ_ONCE(ring->header->tail) ? EPOLLIN | EPOLLRDNORM : 0;
+}
+
+static long lg_g710_plus_ring_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    struct lg_g710_plus_ring *ring = file->private_data;
+    struct g710_keys_snapshot snapshot;
+
+    if (cmd != G710_IOC_KEYS) {
+        return -ENOTTY;
+    }
+    lg_g710_plus_keys_read(&ring->keys, &snapshot);
+    if (copy_to_user((void __user *)arg, &snapshot, sizeof(snapshot))) {
+        return -EFAULT;
+    }
+    return 0;
+}
+
+static const struct file_operations lg_g710_plus_ring_fops = {
+    .owner = THIS_MODULE,
+    .open = lg_g710_plus_ring_open,
+    .release = lg_g710_plus_ring_close,
+    .mmap = lg_g710_plus_ring_mmap,
+    .poll = lg_g710_plus_ring_poll,
+    .unlocked_ioctl = lg_g710_plus_ring_ioctl,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,5,0)
+    .compat_ioctl = compat_ptr_ioctl,
+#endif
+    .llseek = noop_llseek,
+};
+
+static int lg_g710_plus_ring_create(struct lg_g710_plus_data *data)
+{
+    int ret;
+    unsigned long flags;
+    struct lg_g710_plus_ring *ring;
+
+    ring= kzalloc(sizeof(struct lg_g710_plus_ring), GFP_KERNEL);
+    if (ring == NULL) {
+        return -ENOMEM;
+    }
+
+    ring->header= vmalloc_user(PAGE_ALIGN(G710_RING_SIZE));
+    if (ring->header == NULL) {
+        kfree(ring);
+        return -ENOMEM;
+    }
+    ring->records= (struct g710_ring_record *)((u8 *)ring->header + G710_RING_HEADER_SIZE);
+    ring->header->magic= G710_RING_MAGIC;
+    ring->header->version= G710_RING_VERSION;
+    ring->header->records= G710_RING_RECORDS;
+
+    ring->index= ida_alloc(&lg_g710_plus_ring_ida, GFP_KERNEL);
+    if (ring->index < 0) {
+        ret= ring->index;
+        vfree(ring->header);
+        kfree(ring);
+        return ret;
+    }
+
+    kref_init(&ring->kref);
+    init_waitqueue_head(&ring->wait);
+    seqcount_init(&ring->keys.seq);
+    snprintf(ring->name, sizeof(ring->name), "g710plus-events%d", ring->index);
+    ring->misc.minor= MISC_DYNAMIC_MINOR;
+    ring->misc.name= ring->name;
+    ring->misc.fops= &lg_g710_plus_ring_fops;
+    ring->misc.parent= &data->hdev->dev;
+
+    ret= misc_register(&ring->misc);
+    if (ret) {
+        kref_put(&ring->kref, lg_g710_plus_ring_release);
+        return ret;
+    }
+    spin_lock_irqsave(&data->key_lock, flags);
+    data->ring= ring;
+    spin_unlock_irqrestore(&data->key_lock, flags);
+    return 0;
+}
+
+static void lg_g710_plus_ring_destroy(struct lg_g710_plus_data *data)
+{
+    unsigned long flags;
+    struct lg_g710_plus_ring *ring = data->ring;
+
+    if (ring == NULL) {
+        return;
+    }
+
+    spin_lock_irqsave(&data->key_lock, flags);
+    data->ring= NULL;
+    spin_unlock_irqrestore(&data->key_lock, flags);
+
+    WRITE_ONCE(ring->disconnected, true);
+    wake_up_interruptible(&ring->wait);
+    misc_deregister(&ring->misc);
+    kref_put(&ring->kref, lg_g710_plus_ring_release);
+}
+
+static bool lg_g710_plus_is_usb(struct hid_device *hdev)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,15,0)
+    return hid_is_usb(hdev);
+#else
+    return hdev->ll_driver == &usb_hid_driver;
+#endif
+}
+
+static struct usb_host_endpoint* lg_g710_plus_intf_int_in_endpoint(struct usb_interface *intf)
+{
     u8 i;
-    u16 keys_pressed;
-    struct lg_g710_plus_data* g710_data = lg_g710_plus_get_data(hdev);
-    if (g710_data == NULL || size < 3 || data[0] != 3) {
-        return 1; /* cannot handle the event */
-    }
+    struct usb_host_interface *interface = intf->cur_altsetting;
 
-    keys_pressed= data[1] << 8 | data[2];
-    for (i = 0; i < LOGITECH_KEY_MAP_SIZE; i++) {
-        if (g710_plus_key_map[i] != 0 && (BIT_AT(keys_pressed, i) != BIT_AT(g710_data->macro_button_state, i))) {
-            input_report_key(g710_data->input_dev, g710_plus_key_map[i], BIT_AT(keys_pressed, i) != 0);
+    for (i = 0; i < interface->desc.bNumEndpoints; i++) {
+        if (usb_endpoint_is_int_in(&interface->endpoint[i].desc)) {
+            return &interface->endpoint[i];
         }
     }
-    input_sync(g710_data->input_dev);
-    g710_data->macro_button_state= keys_pressed;
-    return 1;
+    return NULL;
 }
 
-static int lg_g710_plus_extra_led_mr_event(struct hid_device *hdev, struct hid_report *report, u8 *data, int size) {
-    struct lg_g710_plus_data* g710_data = lg_g710_plus_get_data(hdev);
-    g710_data->led_macro= (data[1] >> 4) & 0xF;
-    complete_all(&g710_data->ready);
-    return 1;
+static struct usb_host_endpoint* lg_g710_plus_int_in_endpoint(struct hid_device *hdev)
+{
+    return lg_g710_plus_intf_int_in_endpoint(to_usb_interface(hdev->dev.parent));
 }
 
-static int lg_g710_plus_extra_led_keys_event(struct hid_device *hdev, struct hid_report *report, u8 *data, int size) {
-    struct lg_g710_plus_data* g710_data = lg_g710_plus_get_data(hdev);
-    g710_data->led_keys= data[1] << 4 | data[2];
-    complete_all(&g710_data->ready);
-    return 1;
+/*
+ * Looks up the bInterval the device reports for endpoint in the raw configuration descriptor.
+ * The parsed descriptor may hold an override from an earlier bind, the raw one is never changed
+ */
+static u8 lg_g710_plus_device_binterval(struct hid_device *hdev, struct usb_host_endpoint *endpoint)
+{
+    struct usb_interface *intf = to_usb_interface(hdev->dev.parent);
+    struct usb_device *udev = hid_to_usb_dev(hdev);
+    struct usb_interface_descriptor *interface;
+    struct usb_endpoint_descriptor *desc;
+    struct usb_descriptor_header *header;
+    unsigned int pos, size;
+    bool in_interface = false;
+    u8 *raw;
+
+    if (udev->actconfig == NULL || udev->rawdescriptors == NULL) {
+        return endpoint->desc.bInterval;
+    }
+    raw= (u8 *)udev->rawdescriptors[udev->actconfig - udev->config];
+    size= le16_to_cpu(udev->actconfig->desc.wTotalLength);
+
+    for (pos = 0; pos + sizeof(struct usb_descriptor_header) <= size; pos += header->bLength) {
+        header= (struct usb_descriptor_header *)(raw + pos);
+        if (header->bLength < sizeof(struct usb_descriptor_header) || pos + header->bLength > size) {
+            break;
+        }
+        if (header->bDescriptorType == USB_DT_INTERFACE && header->bLength >= USB_DT_INTERFACE_SIZE) {
+            interface= (struct usb_interface_descriptor *)header;
+            in_interface= interface->bInterfaceNumber == intf->cur_altsetting->desc.bInterfaceNumber &&
+                interface->bAlternateSetting == intf->cur_altsetting->desc.bAlternateSetting;
+        } else if (in_interface && header->bDescriptorType == USB_DT_ENDPOINT && header->bLength >= USB_DT_ENDPOINT_SIZE) {
+            desc= (struct usb_endpoint_descriptor *)header;
+            if (desc->bEndpointAddress == endpoint->desc.bEndpointAddress) {
+                return desc->bInterval;
+            }
+        }
+    }
+    return endpoint->desc.bInterval;
 }
 
-static int lg_g710_plus_raw_event(struct hid_device *hdev, struct hid_report *report, u8 *data, int size)
+/*
+ * Converts a polling interval into the bInterval of the interrupt in endpoint, 0 into the one
+ * of the device. Returns the bInterval or a negative error code
+ */
+static int lg_g710_plus_poll_binterval(struct hid_device *hdev, unsigned int interval_ms)
 {
-    switch(report->id) {
-        case 3: return lg_g710_plus_extra_key_event(hdev, report, data, size);
-        case 6: return lg_g710_plus_extra_led_mr_event(hdev, report, data, size);
-        case 8: return lg_g710_plus_extra_led_keys_event(hdev, report, data, size);
-        default: return 0;
+    struct lg_g710_plus_data *data = lg_g710_plus_get_data(hdev);
+
+    if (data->default_binterval == 0) {
+        return -ENODEV;
+    }
+    if (interval_ms != 0 && (interval_ms < LOGITECH_POLL_INTERVAL_MIN || interval_ms > LOGITECH_POLL_INTERVAL_MAX)) {
+        return -EINVAL;
     }
+
+    if (interval_ms == 0) {
+        return data->default_binterval;
+    } else if (hid_to_usb_dev(hdev)->speed >= USB_SPEED_HIGH) {
+        return min(ilog2(interval_ms * 8) + 1, 16); /* 2^(bInterval-1) microframes */
+    }
+    return interval_ms; /* frames */
 }
 
-static int lg_g710_plus_input_mapping(struct hid_device *hdev, struct hid_input *hi, struct hid_field *field, struct hid_usage *usage, unsigned long **bit, int *max) 
+/*
+ * usbhid takes bInterval from the endpoint descriptor when it sets up the urb in hid_hw_start(),
+ * so a new interval applies to a bound interface by rebinding it. remove() puts back the interval
+ * of the device, it is overridden while no driver is bound and probe() keeps the override
+ */
+static void lg_g710_plus_rebind_work(struct work_struct *work)
 {
-    struct lg_g710_plus_data* data = lg_g710_plus_get_data(hdev);
-    if (data != NULL && data->input_dev == NULL) {
-        data->input_dev= hi->input;
+    int ret;
+    struct lg_g710_plus_rebind *rebind = container_of(work, struct lg_g710_plus_rebind, work);
+    struct usb_interface *intf = rebind->intf;
+    struct usb_device *udev = interface_to_usbdev(intf);
+    struct usb_host_endpoint *endpoint;
+
+    device_release_driver(&intf->dev);
+
+    usb_lock_device(udev);
+    if (udev->state != USB_STATE_NOTATTACHED) {
+        endpoint= lg_g710_plus_intf_int_in_endpoint(intf);
+        if (endpoint != NULL) {
+            endpoint->desc.bInterval= rebind->binterval;
+        }
+        ret= device_attach(&intf->dev);
+        if (ret < 0) {
+            dev_warn(&intf->dev, "can't bind again after changing the polling interval: %d\n", ret);
+        }
     }
-    return 0;
-}
+    usb_unlock_device(udev);
 
-enum req_type {
-    REQTYPE_READ,
-    REQTYPE_WRITE
-};
+    usb_put_intf(intf);
+    kfree(rebind);
+}
 
-static void hidhw_request(struct hid_device *hdev, struct hid_report *report, enum req_type reqtype) {
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,10,0)
-    hid_hw_request(hdev, report, reqtype == REQTYPE_READ ? HID_REQ_GET_REPORT : HID_REQ_SET_REPORT);
-#else
-    usbhid_submit_report(hdev, report, reqtype == REQTYPE_READ ? USB_DIR_IN : USB_DIR_OUT);
+/* Finds the state of the other interface of the same keyboard, or creates it */
+static struct lg_g710_plus_shared* lg_g710_plus_shared_get(struct hid_device *hdev)
+{
+    struct lg_g710_plus_shared *shared;
+    struct device *parent = hdev->dev.parent;
+#ifdef CONFIG_PM
+    struct usb_device *udev;
 #endif
-}
 
-static int lg_g710_plus_initialize(struct hid_device *hdev) {
-    int ret = 0;
-    struct lg_g710_plus_data *data;
-    struct list_head *feature_report_list = &hdev->report_enum[HID_FEATURE_REPORT].report_list;
-    struct hid_report *report;
+    /* usb interface -> usb device; virtual devices do not share their state */
+    parent= (parent != NULL && parent->parent != NULL) ? parent->parent : &hdev->dev;
 
-    if (list_empty(feature_report_list)) {
-        return 0; /* Currently, the keyboard registers as two different devices */
+    mutex_lock(&lg_g710_plus_shared_lock);
+    list_for_each_entry(shared, &lg_g710_plus_shared_list, list) {
+        if (shared->parent == parent) {
+            kref_get(&shared->kref);
+            goto out;
+        }
     }
 
-    data = lg_g710_plus_get_data(hdev);
-    list_for_each_entry(report, feature_report_list, list) {
-        switch(report->id) {
-            case 6: data->mr_buttons_led_report= report; break;
-            case 8: data->other_buttons_led_report= report; break;
-            case 9:
-                data->g_mr_buttons_support_report= report;
-                hidhw_request(hdev, report, REQTYPE_WRITE);
-                break;
+    shared= kzalloc(sizeof(struct lg_g710_plus_shared), GFP_KERNEL);
+    if (shared != NULL) {
+        kref_init(&shared->kref);
+        spin_lock_init(&shared->lock);
+        shared->parent= parent;
+        shared->last_input= jiffies;
+#ifdef CONFIG_PM
+        if (lg_g710_plus_is_usb(hdev)) {
+            /* before either interface changes them, see enable_autosuspend */
+            udev= hid_to_usb_dev(hdev);
+            shared->old_wakeup= device_may_wakeup(&udev->dev);
+            shared->old_autosuspend= udev->dev.power.runtime_auto;
+            shared->old_autosuspend_delay= udev->dev.power.autosuspend_delay;
         }
+#endif
+        list_add(&shared->list, &lg_g710_plus_shared_list);
     }
+out:
+    mutex_unlock(&lg_g710_plus_shared_lock);
+    return shared;
+}
 
-    ret= sysfs_create_group(&hdev->dev.kobj, &data->attr_group);
-    return ret;
+static void lg_g710_plus_shared_release(struct kref *kref)
+{
+    struct lg_g710_plus_shared *shared = container_of(kref, struct lg_g710_plus_shared, kref);
+#ifdef CONFIG_PM
+    struct usb_device *udev;
+
+    if (shared->autosuspend_changed) {
+        /* the usb device stays after unbind, put back the settings found at the first bind */
+        udev= to_usb_device(shared->parent);
+        if (!shared->old_autosuspend) {
+            usb_disable_autosuspend(udev);
+        }
+        pm_runtime_set_autosuspend_delay(&udev->dev, shared->old_autosuspend_delay);
+        device_set_wakeup_enable(&udev->dev, shared->old_wakeup);
+    }
+#endif
+    list_del(&shared->list);
+    kfree(rcu_dereference_protected(shared->remap, 1));
+    kfree(shared);
 }
 
-static struct lg_g710_plus_data* lg_g710_plus_create(struct hid_device *hdev)
+static void lg_g710_plus_shared_put(struct lg_g710_plus_shared *shared)
+{
+    mutex_lock(&lg_g710_plus_shared_lock);
+    kref_put(&shared->kref, lg_g710_plus_shared_release);
+    mutex_unlock(&lg_g710_plus_shared_lock);
+}
+
+static struct lg_g710_plus_data* lg_g710_plus_create(struct hid_device *hdev, const struct hid_device_id *id)
 {
     struct lg_g710_plus_data* data;
     data= kzalloc(sizeof(struct lg_g710_plus_data), GFP_KERNEL);
@@ -187,21 +1991,116 @@ static struct lg_g710_plus_data* lg_g710_plus_create(struct hid_device *hdev)
         return NULL;
     }
 
+    data->shared= lg_g710_plus_shared_get(hdev);
+    if (data->shared == NULL) {
+        kfree(data);
+        return NULL;
+    }
+
+    data->model= (const struct lg_g710_plus_model *)id->driver_data;
     data->attr_group.name= "logitech-g710";
     data->attr_group.attrs= lg_g710_plus_attrs;
     data->hdev= hdev;
 
-    spin_lock_init(&data->lock);
+    mutex_init(&data->lock);
+    spin_lock_init(&data->key_lock);
+    mutex_init(&data->notify_lock);
+    seqcount_init(&data->keys.seq);
     init_completion(&data->ready);
+    init_completion(&data->initialized);
+    INIT_WORK(&data->init_work, lg_g710_plus_init_work);
+    INIT_DELAYED_WORK(&data->dim_work, lg_g710_plus_dim_work);
+    INIT_DELAYED_WORK(&data->notify_work, lg_g710_plus_notify_work);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,13,0)
+    hrtimer_setup(&data->key_timer, lg_g710_plus_key_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+#else
+    hrtimer_init(&data->key_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+    data->key_timer.function= lg_g710_plus_key_timer;
+#endif
     return data;
 }
 
+#ifdef CONFIG_PM
+/* Writes the cached led state back, the keyboard does not keep it across a suspend */
+static void lg_g710_plus_restore_leds(struct lg_g710_plus_data *data)
+{
+    mutex_lock(&data->lock);
+    if (data->mr_buttons_led_report != NULL) {
+        data->mr_buttons_led_report->field[0]->value[0]= data->led_macro << data->model->led_macro_shift;
+        hidhw_request(data->hdev, data->mr_buttons_led_report, REQTYPE_WRITE);
+    }
+    mutex_unlock(&data->lock);
+    if (data->other_buttons_led_report != NULL) {
+        lg_g710_plus_write_led_keys(data, data->led_keys);
+    }
+}
+
+static int lg_g710_plus_resume(struct hid_device *hdev)
+{
+    struct lg_g710_plus_data* data = lg_g710_plus_get_data(hdev);
+    if (data == NULL) {
+        return 0;
+    }
+
+    data->resume_time= ktime_get();
+    data->wake_pending= true;
+    /* before the deferred init the cache holds nothing worth restoring */
+    if (completion_done(&data->initialized)) {
+        lg_g710_plus_restore_leds(data);
+    }
+    return 0;
+}
+
+/* After a reset the macro keys are disabled again */
+static int lg_g710_plus_reset_resume(struct hid_device *hdev)
+{
+    struct lg_g710_plus_data* data = lg_g710_plus_get_data(hdev);
+    if (data != NULL && data->g_mr_buttons_support_report != NULL && completion_done(&data->initialized)) {
+        hidhw_request(hdev, data->g_mr_buttons_support_report, REQTYPE_WRITE);
+    }
+    return lg_g710_plus_resume(hdev);
+}
+#endif
+
+/*
+ * usbhid keeps the interrupt urb running while the device is open, unless autosuspend is
+ * enabled: then it arms remote wakeup and suspends after the idle delay. The key that wakes
+ * the keyboard is reported once the urb runs again, macro_button_state is kept meanwhile.
+ * The settings belong to the usb device that both interfaces share: shared_get saves them
+ * for the first interface, the last shared_put restores them
+ */
+static void lg_g710_plus_enable_autosuspend(struct hid_device *hdev)
+{
+#ifdef CONFIG_PM
+    struct lg_g710_plus_data* data = lg_g710_plus_get_data(hdev);
+    struct usb_device *udev;
+
+    if (autosuspend_delay_ms < 0 || !lg_g710_plus_is_usb(hdev)) {
+        return;
+    }
+
+    udev= hid_to_usb_dev(hdev);
+    if (!device_can_wakeup(&udev->dev)) {
+        hid_info(hdev, "no remote wakeup, not enabling autosuspend\n");
+        return;
+    }
+    mutex_lock(&lg_g710_plus_shared_lock);
+    data->shared->autosuspend_changed= true;
+    mutex_unlock(&lg_g710_plus_shared_lock);
+    device_set_wakeup_enable(&udev->dev, true);
+    pm_runtime_set_autosuspend_delay(&udev->dev, autosuspend_delay_ms);
+    usb_enable_autosuspend(udev);
+#endif
+}
+
 static int lg_g710_plus_probe(struct hid_device *hdev, const struct hid_device_id *id)
 {
     int ret;
     struct lg_g710_plus_data *data;
+    struct usb_host_endpoint *endpoint;
+    ktime_t start = ktime_get();
 
-    data = lg_g710_plus_create(hdev);
+    data = lg_g710_plus_create(hdev, id);
     if (data == NULL) {
         dev_err(&hdev->dev, "can't allocate space for Logitech G710+ device attributes\n");
         ret= -ENOMEM;
@@ -221,23 +2120,74 @@ static int lg_g710_plus_probe(struct hid_device *hdev, const struct hid_device_i
         goto err_free;
     }
 
+    if (lg_g710_plus_is_usb(hdev) && lg_g710_plus_int_in_endpoint(hdev) != NULL) {
+        endpoint= lg_g710_plus_int_in_endpoint(hdev);
+        data->default_binterval= lg_g710_plus_device_binterval(hdev, endpoint);
+        /* an interval written to the poll_interval_ms file is set already, before the rebind */
+        if (poll_interval_ms != 0 && endpoint->desc.bInterval == data->default_binterval) {
+            ret= lg_g710_plus_poll_binterval(hdev, poll_interval_ms);
+            if (ret < 0) {
+                hid_warn(hdev, "invalid poll_interval_ms %u, keeping the interval of the device\n", poll_interval_ms);
+            } else {
+                endpoint->desc.bInterval= ret;
+            }
+        }
+    }
+
     ret = hid_hw_start(hdev, HID_CONNECT_DEFAULT);
     if (ret) {
         hid_err(hdev, "hw start failed\n");
         goto err_free;
     }
 
+    /* after hid_hw_start(), so that the input device is never opened on a stopped device */
+    ret = lg_g710_plus_create_input(hdev);
+    if (ret) {
+        hid_err(hdev, "can't register macro key input device\n");
+        goto err_stop;
+    }
+
+    if (event_device && data->input_dev != NULL) {
+        ret = lg_g710_plus_ring_create(data);
+        if (ret) {
+            hid_err(hdev, "can't register event device\n");
+            goto err_stop;
+        }
+    }
+
     ret= lg_g710_plus_initialize(hdev);
     if (ret) {
         ret = -ret;
-        hid_hw_stop(hdev);
-        goto err_free;
+        goto err_stop;
+    }
+
+    if (data->default_binterval != 0) {
+        /* the other groups are only created on the interface with the feature reports */
+        if (list_empty(&hdev->report_enum[HID_FEATURE_REPORT].report_list)) {
+            ret= sysfs_create_group(&hdev->dev.kobj, &lg_g710_plus_usb_attr_group);
+        } else {
+            ret= sysfs_merge_group(&hdev->dev.kobj, &lg_g710_plus_usb_attr_group);
+        }
+        if (ret) {
+            hid_warn(hdev, "can't create poll_interval_ms attribute\n");
+        }
     }
 
+    lg_g710_plus_enable_autosuspend(hdev);
+    lg_g710_plus_debugfs_init(data);
+    hid_dbg(hdev, "probe took %lld us\n", ktime_us_delta(ktime_get(), start));
     return 0;
 
+err_stop:
+    lg_g710_plus_ring_destroy(data);
+    lg_g710_plus_destroy_input(data);
+    hid_hw_stop(hdev);
 err_free:
+    if (data != NULL && data->default_binterval != 0) {
+        lg_g710_plus_int_in_endpoint(hdev)->desc.bInterval= data->default_binterval;
+    }
     if (data != NULL) {
+        lg_g710_plus_shared_put(data->shared);
         kfree(data);
     }
     return ret;
@@ -248,11 +2198,40 @@ static void lg_g710_plus_remove(struct hid_device *hdev)
     struct lg_g710_plus_data* data = lg_g710_plus_get_data(hdev);
     struct list_head *feature_report_list = &hdev->report_enum[HID_FEATURE_REPORT].report_list;
 
+    if (data != NULL && data->default_binterval != 0) {
+        if (list_empty(feature_report_list)) {
+            sysfs_remove_group(&hdev->dev.kobj, &lg_g710_plus_usb_attr_group);
+        } else {
+            sysfs_unmerge_group(&hdev->dev.kobj, &lg_g710_plus_usb_attr_group);
+        }
+    }
     if (data != NULL && !list_empty(feature_report_list))
         sysfs_remove_group(&hdev->dev.kobj, &data->attr_group);
+    if (data != NULL) {
+        /*
+         * With the attributes gone nothing queues init_work or notify_work again, and
+         * dim_stop unhooks the backlight from undim, the only other way to dim_work
+         */
+        cancel_work_sync(&data->init_work);
+        lg_g710_plus_dim_stop(data);
+        lg_g710_plus_notify_stop(data);
+    }
+
+    /* the descriptor outlives the driver, the next one starts from the interval of the device */
+    if (data != NULL && data->default_binterval != 0) {
+        lg_g710_plus_int_in_endpoint(hdev)->desc.bInterval= data->default_binterval;
+    }
+
+    if (data != NULL) {
+        debugfs_remove_recursive(data->debugfs_dir);
+        /* before hid_hw_stop(), which the input device still reaches through hid_hw_close() */
+        lg_g710_plus_ring_destroy(data);
+        lg_g710_plus_destroy_input(data);
+    }
 
     hid_hw_stop(hdev);
     if (data != NULL) {
+        lg_g710_plus_shared_put(data->shared);
         kfree(data);
     }
 }
@@ -261,11 +2240,15 @@ static ssize_t lg_g710_plus_show_led_macro(struct device *device, struct device_
 {
     struct lg_g710_plus_data* data = hid_get_drvdata(dev_get_drvdata(device->parent));
     if (data != NULL) {
-        spin_lock(&data->lock);
+        lg_g710_plus_wait_initialized(data);
+        if (mutex_lock_interruptible(&data->lock)) {
+            return -ERESTARTSYS;
+        }
         init_completion(&data->ready);
         hidhw_request(data->hdev, data->mr_buttons_led_report, REQTYPE_READ);
-        wait_for_completion_timeout(&data->ready, WAIT_TIME_OUT);
-        spin_unlock(&data->lock);
+        /* an unanswered or interrupted read returns the cached state */
+        wait_for_completion_interruptible_timeout(&data->ready, msecs_to_jiffies(WAIT_TIME_OUT));
+        mutex_unlock(&data->lock);
         return sprintf(buf, "%d\n", data->led_macro);
     }
     return 0;
@@ -275,11 +2258,15 @@ static ssize_t lg_g710_plus_show_led_keys(struct device *device, struct device_a
 {
     struct lg_g710_plus_data* data = hid_get_drvdata(dev_get_drvdata(device->parent));
     if (data != NULL) {
-        spin_lock(&data->lock);
+        lg_g710_plus_wait_initialized(data);
+        if (mutex_lock_interruptible(&data->lock)) {
+            return -ERESTARTSYS;
+        }
         init_completion(&data->ready);
         hidhw_request(data->hdev, data->other_buttons_led_report, REQTYPE_READ);
-        wait_for_completion_timeout(&data->ready, WAIT_TIME_OUT);
-        spin_unlock(&data->lock);
+        /* an unanswered or interrupted read returns the cached state */
+        wait_for_completion_interruptible_timeout(&data->ready, msecs_to_jiffies(WAIT_TIME_OUT));
+        mutex_unlock(&data->lock);
         return sprintf(buf, "%d\n", data->led_keys);
     }
     return 0;
@@ -294,10 +2281,11 @@ static ssize_t lg_g710_plus_store_led_macro(struct device *device, struct device
     if (retval)
         return retval;
 
-    spin_lock(&data->lock);
-    data->mr_buttons_led_report->field[0]->value[0]= (key_mask & 0xF) << 4;
-    hidhw_request(data->hdev, data->mr_buttons_led_report, REQTYPE_WRITE);
-    spin_unlock(&data->lock);
+    lg_g710_plus_wait_initialized(data);
+    mutex_lock(&data->notify_lock);
+    data->led_macro_base= key_mask & 0xF; /* shown once no notification is active */
+    lg_g710_plus_led_macro_commit(data);
+    mutex_unlock(&data->notify_lock);
     return count;
 }
 
@@ -314,40 +2302,340 @@ static ssize_t lg_g710_plus_store_led_keys(struct device *device, struct device_
     wasd_mask= (key_mask >> 4) & 0xF;
     keys_mask= (key_mask) & 0xF;
 
-    wasd_mask= wasd_mask > 4 ? 4 : wasd_mask;
-    keys_mask= keys_mask > 4 ? 4 : keys_mask;
+    wasd_mask= min_t(u8, wasd_mask, data->model->led_keys_max);
+    keys_mask= min_t(u8, keys_mask, data->model->led_keys_max);
 
-    spin_lock(&data->lock);
-    data->other_buttons_led_report->field[0]->value[0]= wasd_mask;
-    data->other_buttons_led_report->field[0]->value[1]= keys_mask;
-    hidhw_request(data->hdev, data->other_buttons_led_report, REQTYPE_WRITE);
-    spin_unlock(&data->lock);
+    lg_g710_plus_wait_initialized(data);
+    lg_g710_plus_write_led_keys(data, wasd_mask << 4 | keys_mask);
+    lg_g710_plus_led_update(data->hdev, ktime_get(), &data->led_keys, G710_RECORD_LED_KEYS, G710_ATTR_LED_KEYS, wasd_mask << 4 | keys_mask);
+    data->dim_saved= wasd_mask << 4 | keys_mask; /* restored after dimming instead of the old levels */
+    return count;
+}
+
+static ssize_t lg_g710_plus_show_chords(struct device *device, struct device_attribute *attr, char *buf)
+{
+    int i, len = 0;
+    struct lg_g710_plus_data* data = hid_get_drvdata(dev_get_drvdata(device->parent));
+    for (i = 1; i < LOGITECH_CHORD_MAP_SIZE; i++) {
+        if (data->chord_map[i] != 0) {
+            len += scnprintf(buf + len, PAGE_SIZE - len, "%d %d\n", i, data->chord_map[i]);
+        }
+    }
+    return len;
+}
+
+static ssize_t lg_g710_plus_store_chords(struct device *device, struct device_attribute *attr, const char *buf, size_t count)
+{
+    unsigned int mask, code;
+    unsigned long flags;
+    struct lg_g710_plus_data* data = hid_get_drvdata(dev_get_drvdata(device->parent));
+    if (sscanf(buf, "%u %u", &mask, &code) != 2)
+        return -EINVAL;
+    if (mask == 0 || mask >= BIT(hweight16(data->model->g_keys_mask)) || !lg_g710_plus_code_valid(code))
+        return -EINVAL;
+    if (data->input_dev == NULL)
+        return -ENODEV;
+
+    spin_lock_irqsave(&data->key_lock, flags);
+    data->chord_map[mask]= code;
+    lg_g710_plus_chord_members_update(data);
+    spin_unlock_irqrestore(&data->key_lock, flags);
+    return count;
+}
+
+static ssize_t lg_g710_plus_show_tap_hold(struct device *device, struct device_attribute *attr, char *buf)
+{
+    int g, len = 0;
+    struct lg_g710_plus_data* data = hid_get_drvdata(dev_get_drvdata(device->parent));
+    for (g = 0; g < LOGITECH_G_KEYS; g++) {
+        if (data->hold_code[g] != 0) {
+            len += scnprintf(buf + len, PAGE_SIZE - len, "%d %d %d %d\n", g + 1,
+                    data->tap_code[g], data->hold_code[g], data->hold_threshold_ms[g]);
+        }
+    }
+    return len;
+}
+
+static ssize_t lg_g710_plus_store_tap_hold(struct device *device, struct device_attribute *attr, const char *buf, size_t count)
+{
+    unsigned int g, tap, hold, threshold_ms;
+    unsigned long flags;
+    struct lg_g710_plus_data* data = hid_get_drvdata(dev_get_drvdata(device->parent));
+    if (sscanf(buf, "%u %u %u %u", &g, &tap, &hold, &threshold_ms) != 4)
+        return -EINVAL;
+    if (g < 1 || g > hweight16(data->model->g_keys_mask) || !lg_g710_plus_code_valid(tap) ||
+            !lg_g710_plus_code_valid(hold) || threshold_ms > U16_MAX)
+        return -EINVAL;
+    if (data->input_dev == NULL)
+        return -ENODEV;
+
+    spin_lock_irqsave(&data->key_lock, flags);
+    lg_g710_plus_tap_hold_resolve(data, BIT(g - 1));
+    data->tap_code[g - 1]= tap;
+    data->hold_code[g - 1]= hold;
+    data->hold_threshold_ms[g - 1]= threshold_ms;
+    spin_unlock_irqrestore(&data->key_lock, flags);
+    return count;
+}
+
+/*
+ * Installs a new remap table. Format: "G7RM", version (1), number of banks (0-3), two reserved
+ * bytes, then for each bank 256 little endian keycodes indexed by keyboard usage (0 keeps the
+ * key). With 0 banks the remap layer is turned off
+ */
+static ssize_t lg_g710_plus_store_remap(struct device *device, struct device_attribute *attr, const char *buf, size_t count)
+{
+    int ret;
+    const u8 *blob = (const u8 *)buf;
+    struct lg_g710_plus_remap *remap;
+    struct lg_g710_plus_data* data = hid_get_drvdata(dev_get_drvdata(device->parent));
+
+    if (count < LOGITECH_REMAP_HEADER_SIZE || memcmp(blob, LOGITECH_REMAP_MAGIC, 4) != 0 ||
+            blob[4] != LOGITECH_REMAP_VERSION || blob[5] > LOGITECH_BANKS ||
+            count != LOGITECH_REMAP_HEADER_SIZE + blob[5] * LOGITECH_REMAP_USAGES * 2)
+        return -EINVAL;
+
+    ret= lg_g710_plus_remap_parse(blob + LOGITECH_REMAP_HEADER_SIZE, blob[5], &remap);
+    if (ret)
+        return ret;
+    lg_g710_plus_remap_install(data->shared, remap);
+    return count;
+}
+
+static ssize_t lg_g710_plus_show_poll_interval(struct device *device, struct device_attribute *attr, char *buf)
+{
+    u8 binterval;
+    struct lg_g710_plus_data* data = hid_get_drvdata(dev_get_drvdata(device->parent));
+    binterval= lg_g710_plus_int_in_endpoint(data->hdev)->desc.bInterval;
+    if (hid_to_usb_dev(data->hdev)->speed >= USB_SPEED_HIGH) {
+        return sprintf(buf, "%d\n", max((1 << (binterval - 1)) / 8, 1));
+    }
+    return sprintf(buf, "%d\n", binterval);
+}
+
+static ssize_t lg_g710_plus_store_poll_interval(struct device *device, struct device_attribute *attr, const char *buf, size_t count)
+{
+    int ret;
+    unsigned int interval_ms;
+    struct lg_g710_plus_rebind *rebind;
+    struct lg_g710_plus_data* data = hid_get_drvdata(dev_get_drvdata(device->parent));
+    if (kstrtouint(buf, 10, &interval_ms))
+        return -EINVAL;
+    ret= lg_g710_plus_poll_binterval(data->hdev, interval_ms);
+    if (ret < 0)
+        return ret;
+
+    /* unbinding removes this file, so it happens from the workqueue */
+    rebind= kzalloc(sizeof(struct lg_g710_plus_rebind), GFP_KERNEL);
+    if (rebind == NULL)
+        return -ENOMEM;
+    INIT_WORK(&rebind->work, lg_g710_plus_rebind_work);
+    rebind->intf= usb_get_intf(to_usb_interface(data->hdev->dev.parent));
+    rebind->binterval= ret;
+    queue_work(lg_g710_plus_rebind_wq, &rebind->work);
+    return count;
+}
+
+/* Prints the generation and the report 3 bitmap of the macro keys held right now */
+static ssize_t lg_g710_plus_show_keys(struct device *device, struct device_attribute *attr, char *buf)
+{
+    struct g710_keys_snapshot snapshot;
+    struct lg_g710_plus_data* data = hid_get_drvdata(dev_get_drvdata(device->parent));
+    if (data->hdev->report_enum[HID_INPUT_REPORT].report_id_hash[data->model->keys_report_id] == NULL)
+        return -ENODEV; /* the macro keys are reported by the other interface */
+
+    lg_g710_plus_keys_read(&data->keys, &snapshot);
+    return sprintf(buf, "%llu 0x%04x\n", (unsigned long long)snapshot.generation, snapshot.keys);
+}
+
+/* Validates and applies a whole profile blob, see hid-lg-g710-plus.h */
+static ssize_t lg_g710_plus_store_profile(struct device *device, struct device_attribute *attr, const char *buf, size_t count)
+{
+    int ret;
+    struct lg_g710_plus_profile *parsed;
+    struct lg_g710_plus_data* data = hid_get_drvdata(dev_get_drvdata(device->parent));
+
+    parsed= lg_g710_plus_profile_parse((const u8 *)buf, count);
+    if (IS_ERR(parsed))
+        return PTR_ERR(parsed);
+
+    lg_g710_plus_wait_initialized(data);
+    ret= lg_g710_plus_profile_apply(data, parsed);
+    return ret ? ret : count;
+}
+
+static ssize_t lg_g710_plus_show_dim_timeout(struct device *device, struct device_attribute *attr, char *buf)
+{
+    struct lg_g710_plus_data* data = hid_get_drvdata(dev_get_drvdata(device->parent));
+    return sprintf(buf, "%u\n", data->dim_timeout_s);
+}
+
+static ssize_t lg_g710_plus_store_dim_timeout(struct device *device, struct device_attribute *attr, const char *buf, size_t count)
+{
+    unsigned int timeout_s;
+    struct lg_g710_plus_data* data = hid_get_drvdata(dev_get_drvdata(device->parent));
+    if (kstrtouint(buf, 10, &timeout_s) || timeout_s > U16_MAX)
+        return -EINVAL;
+    if (data->other_buttons_led_report == NULL)
+        return -ENODEV;
+
+    lg_g710_plus_wait_initialized(data);
+    lg_g710_plus_dim_set(data, timeout_s);
     return count;
 }
 
+static ssize_t lg_g710_plus_show_notify(struct device *device, struct device_attribute *attr, char *buf)
+{
+    int i, len = 0;
+    unsigned int remaining_ms;
+    struct lg_g710_plus_data* data = hid_get_drvdata(dev_get_drvdata(device->parent));
+
+    mutex_lock(&data->notify_lock);
+    for (i = 0; i < LOGITECH_NOTIFY_SLOTS; i++) {
+        if (data->notify[i].name[0] == '\0') {
+            continue;
+        }
+        remaining_ms= 0;
+        if (data->notify[i].has_timeout) {
+            /* expired but not removed yet still counts as active */
+            remaining_ms= time_before(jiffies, data->notify[i].expires) ?
+                    max(jiffies_to_msecs(data->notify[i].expires - jiffies), 1U) : 1;
+        }
+        len += scnprintf(buf + len, PAGE_SIZE - len, "%s %d %d %u\n", data->notify[i].name,
+                data->notify[i].priority, data->notify[i].leds, remaining_ms);
+    }
+    mutex_unlock(&data->notify_lock);
+    return len;
+}
+
+/*
+ * "name priority leds [timeout_ms]" shows a notification on the M1-MR leds, or replaces the one
+ * of the same name; without a timeout it stays until removed. "-name" removes it
+ */
+static ssize_t lg_g710_plus_store_notify(struct device *device, struct device_attribute *attr, const char *buf, size_t count)
+{
+    char name[LOGITECH_NOTIFY_NAME_SIZE] = "";
+    unsigned int priority = 0, leds = 0, timeout_ms = 0;
+    int i, len = 0, fields = 0;
+    bool remove = buf[0] == '-';
+    ssize_t ret = count;
+    struct lg_g710_plus_notification *slot = NULL;
+    struct lg_g710_plus_data* data = hid_get_drvdata(dev_get_drvdata(device->parent));
+
+    buf += remove;
+    if (sscanf(buf, "%15s%n", name, &len) != 1 || (buf[len] != '\0' && buf[len] != ' ' && buf[len] != '\n'))
+        return -EINVAL; /* empty or longer than LOGITECH_NOTIFY_NAME_SIZE - 1 */
+    if (!remove)
+        fields= sscanf(buf + len, "%u %u %u", &priority, &leds, &timeout_ms);
+    if ((!remove && fields < 2) || priority > U8_MAX || leds > 0xF)
+        return -EINVAL;
+    if (data->mr_buttons_led_report == NULL)
+        return -ENODEV;
+
+    lg_g710_plus_wait_initialized(data);
+    mutex_lock(&data->notify_lock);
+    for (i = 0; i < LOGITECH_NOTIFY_SLOTS; i++) {
+        if (data->notify[i].name[0] != '\0' && strcmp(data->notify[i].name, name) == 0) {
+            slot= &data->notify[i];
+        }
+    }
+    for (i = 0; i < LOGITECH_NOTIFY_SLOTS && slot == NULL && !remove; i++) {
+        if (data->notify[i].name[0] == '\0') {
+            slot= &data->notify[i];
+        }
+    }
+
+    if (slot == NULL) {
+        ret= remove ? -ENOENT : -ENOSPC;
+    } else if (remove) {
+        slot->name[0]= '\0';
+    } else {
+        memcpy(slot->name, name, sizeof(slot->name));
+        slot->priority= priority;
+        slot->leds= leds;
+        slot->has_timeout= timeout_ms != 0;
+        slot->expires= jiffies + msecs_to_jiffies(timeout_ms);
+    }
+    if (slot != NULL) {
+        lg_g710_plus_notify_update(data);
+    }
+    mutex_unlock(&data->notify_lock);
+    return ret;
+}
+
+/* Lets the remap layer send any configurable keycode on the keyboard input device */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,4,0)
+static int lg_g710_plus_input_configured(struct hid_device *hdev, struct hid_input *hidinput)
+#else
+static void lg_g710_plus_input_configured(struct hid_device *hdev, struct hid_input *hidinput)
+#endif
+{
+    if (test_bit(KEY_A, hidinput->input->keybit)) {
+        lg_g710_plus_announce_codes(hidinput->input);
+    }
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,4,0)
+    return 0;
+#endif
+}
+
 static const struct hid_device_id lg_g710_plus_devices[] = {
-    { HID_USB_DEVICE(USB_VENDOR_ID_LOGITECH, USB_DEVICE_ID_LOGITECH_KEYBOARD_G710_PLUS) },
+    { HID_USB_DEVICE(USB_VENDOR_ID_LOGITECH, USB_DEVICE_ID_LOGITECH_KEYBOARD_G710_PLUS),
+      .driver_data = (kernel_ulong_t)&lg_g710_plus_model_g710_plus },
     { }
 };
 
 MODULE_DEVICE_TABLE(hid, lg_g710_plus_devices);
 static struct hid_driver lg_g710_plus_driver = {
     .name = "hid-lg-g710-plus",
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,2,0)
+    .driver = {
+        .probe_type = PROBE_PREFER_ASYNCHRONOUS, /* several keyboards probe in parallel */
+    },
+#endif
     .id_table = lg_g710_plus_devices,
     .raw_event = lg_g710_plus_raw_event,
-    .input_mapping = lg_g710_plus_input_mapping,
+    .event = lg_g710_plus_event,
+    .report_fixup = lg_g710_plus_report_fixup,
+    .input_configured = lg_g710_plus_input_configured,
     .probe= lg_g710_plus_probe,
     .remove= lg_g710_plus_remove,
+#ifdef CONFIG_PM
+    .resume= lg_g710_plus_resume,
+    .reset_resume= lg_g710_plus_reset_resume,
+#endif
 };
 
 static int __init lg_g710_plus_init(void)
 {
-    return hid_register_driver(&lg_g710_plus_driver);
+    int ret;
+
+    lg_g710_plus_rebind_wq= alloc_ordered_workqueue("hid-lg-g710-plus", 0);
+    if (lg_g710_plus_rebind_wq == NULL)
+        return -ENOMEM;
+
+    ret= genl_register_family(&lg_g710_plus_genl_family);
+    if (ret) {
+        destroy_workqueue(lg_g710_plus_rebind_wq);
+        return ret;
+    }
+
+    lg_g710_plus_debugfs_root= debugfs_create_dir("hid-lg-g710-plus", NULL);
+    ret= hid_register_driver(&lg_g710_plus_driver);
+    if (ret) {
+        debugfs_remove_recursive(lg_g710_plus_debugfs_root);
+        genl_unregister_family(&lg_g710_plus_genl_family);
+        destroy_workqueue(lg_g710_plus_rebind_wq);
+    }
+    return ret;
 }
 
 static void __exit lg_g710_plus_exit(void)
 {
     hid_unregister_driver(&lg_g710_plus_driver);
+    /* no file queues a rebind any more, the pending ones bind the interfaces to hid-generic */
+    destroy_workqueue(lg_g710_plus_rebind_wq);
+    debugfs_remove_recursive(lg_g710_plus_debugfs_root);
+    genl_unregister_family(&lg_g710_plus_genl_family);
 }
 
 module_init(lg_g710_plus_init);
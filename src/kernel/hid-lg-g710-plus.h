@@ -0,0 +1,124 @@
+/*
+ *  Logitech G710+ Keyboard Input Driver
+ *
+ *  Definitions shared with userspace
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#ifndef HID_LG_G710_PLUS_H
+#define HID_LG_G710_PLUS_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/*
+ * Event ring of /dev/g710plus-eventsN (module parameter event_device)
+ *
+ * The device is mapped with mmap() as a whole: the header fills the first page, the
+ * records follow. The driver publishes records at head, the consumer advances tail
+ * after reading. poll() reports POLLIN while head != tail.
+ */
+#define G710_RING_MAGIC 0x47373130 /* "G710" */
+#define G710_RING_VERSION 1
+#define G710_RING_HEADER_SIZE 4096
+#define G710_RING_RECORDS 1024 /* power of two */
+#define G710_RING_SIZE (G710_RING_HEADER_SIZE + G710_RING_RECORDS * sizeof(struct g710_ring_record))
+
+enum g710_record_type {
+    G710_RECORD_KEYS = 1, /* value: report 3 bitmap, M1-MR in bits 4-7, G1-G6 in bits 8-13 */
+    G710_RECORD_LED_MACRO = 2, /* value: M1-MR led bitmask */
+    G710_RECORD_LED_KEYS = 3, /* value: wasd << 4 | keys backlight levels */
+};
+
+struct g710_ring_record {
+    __u64 time_ns; /* CLOCK_MONOTONIC arrival time of the report, or of the write for leds set by the driver */
+    __u16 type; /* enum g710_record_type */
+    __u16 value;
+    __u32 reserved;
+};
+
+/* Keys held right now, returned by G710_IOC_KEYS on the event device */
+struct g710_keys_snapshot {
+    __u64 generation; /* number of key state changes since the keyboard was bound */
+    __u16 keys; /* report 3 bitmap as in G710_RECORD_KEYS */
+    __u16 reserved[3];
+};
+
+#define G710_IOC_MAGIC 'G'
+#define G710_IOC_KEYS _IOR(G710_IOC_MAGIC, 1, struct g710_keys_snapshot)
+
+struct g710_ring_header {
+    __u32 magic;
+    __u32 version;
+    __u32 records; /* number of records in the ring */
+    __u32 reserved;
+    __u64 dropped; /* records lost because the ring was full */
+    __u8 pad0[40];
+    __u64 head; /* written by the driver: records published so far */
+    __u8 pad1[56];
+    __u64 tail; /* written by the consumer: records consumed so far */
+};
+
+/*
+ * Generic netlink family G710_GENL_NAME. Every bank or backlight change is multicast to the
+ * group G710_GENL_MCGRP as a G710_CMD_STATE message carrying G710_ATTR_DEVICE and the
+ * attribute that changed
+ */
+#define G710_GENL_NAME "g710_plus"
+#define G710_GENL_VERSION 1
+#define G710_GENL_MCGRP "state"
+
+enum g710_genl_cmd {
+    G710_CMD_UNSPEC,
+    G710_CMD_STATE,
+};
+
+enum g710_genl_attr {
+    G710_ATTR_UNSPEC,
+    G710_ATTR_DEVICE, /* string: hid device name, e.g. 0003:046D:C24D.0001 */
+    G710_ATTR_BANK, /* u8: bank selected with M1-M3, 0-2 */
+    G710_ATTR_LED_MACRO, /* u8: M1-MR led bitmask */
+    G710_ATTR_LED_KEYS, /* u8: wasd << 4 | keys backlight levels */
+    __G710_ATTR_MAX,
+};
+#define G710_ATTR_MAX (__G710_ATTR_MAX - 1)
+
+/*
+ * Profile blob, loaded from /lib/firmware at probe (module parameter profile) or written to
+ * the profile sysfs file. A header is followed by sections, each one starting with
+ * struct g710_profile_section. Multi-byte values are little endian. A profile replaces the
+ * whole configuration of the sections it contains
+ */
+#define G710_PROFILE_MAGIC "G7PF"
+#define G710_PROFILE_VERSION 1
+#define G710_PROFILE_MAX_SIZE 4096
+
+struct g710_profile_header {
+    __u8 magic[4]; /* G710_PROFILE_MAGIC */
+    __u8 version; /* G710_PROFILE_VERSION */
+    __u8 reserved[3];
+};
+
+struct g710_profile_section {
+    __u8 type; /* enum g710_profile_section_type */
+    __u8 reserved;
+    __u16 length; /* of the payload that follows */
+};
+
+enum g710_profile_section_type {
+    G710_PROFILE_REMAP = 1, /* u8 banks (0-3), u8 reserved, banks * 256 u16 keycodes as in the remap file */
+    G710_PROFILE_LEDS = 2, /* u8 led_macro, u8 led_keys (wasd << 4 | keys) */
+    G710_PROFILE_CHORD = 3, /* u8 G-key mask, u8 reserved, u16 keycode; one section per chord */
+    G710_PROFILE_TAP_HOLD = 4, /* u8 G-key (1-6), u8 reserved, u16 tap, u16 hold, u16 threshold_ms; one section per key */
+    G710_PROFILE_DIM = 5, /* u16 dim_timeout in s, 0 disables dimming */
+};
+
+#endif
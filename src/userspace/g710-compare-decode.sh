@@ -0,0 +1,22 @@
+#!/bin/sh
+#
+# Compares the two ways of decoding the macro keys: by hand in raw_event
+# (native_decode=0) and by hid-input through the fixed up report descriptor
+# (native_decode=1). The module is reloaded for each mode, which also rebinds
+# a connected G710+.
+#
+# Usage: g710-compare-decode.sh [output directory]
+#
+
+set -e
+
+out=${1:-.}
+dir=$(dirname "$0")
+
+for mode in 0 1; do
+    modprobe -r hid-lg-g710-plus || true
+    modprobe hid-lg-g710-plus native_decode=$mode
+    "$dir/g710-uhid-bench" -n 1000000 > "$out/native_decode-$mode.txt"
+    "$dir/g710-latency-bench" > "$out/native_decode-$mode.json"
+    echo "native_decode=$mode: $(cat "$out/native_decode-$mode.txt")"
+done
@@ -0,0 +1,130 @@
+/*
+ *  Logitech G710+ event ring reader
+ *
+ *  Maps /dev/g710plus-eventsN (hid-lg-g710-plus loaded with event_device=1)
+ *  and prints every macro key and LED record as it is published. No system
+ *  call is needed per record, poll() is only used to sleep while the ring is
+ *  empty.
+ *
+ *  With -k it prints the macro keys held right now, as returned by the
+ *  G710_IOC_KEYS ioctl, and exits.
+ *
+ *  Usage: g710-events [-k] [/dev/g710plus-eventsN]
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../kernel/hid-lg-g710-plus.h"
+
+static const char *type_name(unsigned int type)
+{
+    switch (type) {
+        case G710_RECORD_KEYS: return "keys";
+        case G710_RECORD_LED_MACRO: return "led_macro";
+        case G710_RECORD_LED_KEYS: return "led_keys";
+        default: return "unknown";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = "/dev/g710plus-events0";
+    struct g710_keys_snapshot snapshot;
+    struct g710_ring_header *header;
+    struct g710_ring_record *records, *record;
+    struct pollfd pfd;
+    __u64 head, tail, dropped = 0;
+    void *map;
+    int fd, opt, keys = 0;
+
+    while ((opt = getopt(argc, argv, "k")) != -1) {
+        switch (opt) {
+            case 'k': keys = 1; break;
+            default:
+                fprintf(stderr, "usage: %s [-k] [/dev/g710plus-eventsN]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (optind < argc)
+        path = argv[optind];
+
+    fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    if (keys) {
+        if (ioctl(fd, G710_IOC_KEYS, &snapshot) < 0) {
+            fprintf(stderr, "%s: G710_IOC_KEYS failed: %s\n", path, strerror(errno));
+            return 1;
+        }
+        printf("generation %llu keys 0x%04x\n", (unsigned long long)snapshot.generation, snapshot.keys);
+        close(fd);
+        return 0;
+    }
+
+    map = mmap(NULL, G710_RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "cannot map %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    header = map;
+    records = (struct g710_ring_record *)((char *)map + G710_RING_HEADER_SIZE);
+    if (header->magic != G710_RING_MAGIC || header->version != G710_RING_VERSION) {
+        fprintf(stderr, "%s: unknown ring layout\n", path);
+        return 1;
+    }
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    tail = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE); /* only new records */
+    __atomic_store_n(&header->tail, tail, __ATOMIC_RELEASE);
+
+    for (;;) {
+        head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            if (poll(&pfd, 1, -1) < 0 && errno != EINTR)
+                break;
+            if (pfd.revents & (POLLHUP | POLLERR)) {
+                fprintf(stderr, "%s: device is gone\n", path);
+                break;
+            }
+            continue;
+        }
+
+        if (header->dropped != dropped) {
+            printf("dropped %llu records\n", (unsigned long long)(header->dropped - dropped));
+            dropped = header->dropped;
+        }
+        for (; tail != head; tail++) {
+            record = &records[tail & (G710_RING_RECORDS - 1)];
+            printf("%llu.%09llu %s 0x%04x\n",
+                   (unsigned long long)(record->time_ns / 1000000000ULL),
+                   (unsigned long long)(record->time_ns % 1000000000ULL),
+                   type_name(record->type), record->value);
+        }
+        fflush(stdout);
+        __atomic_store_n(&header->tail, tail, __ATOMIC_RELEASE);
+    }
+
+    munmap(map, G710_RING_SIZE);
+    close(fd);
+    return 0;
+}
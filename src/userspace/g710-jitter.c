@@ -0,0 +1,594 @@
+/*
+ *  Logitech G710+ polling rate and report jitter analyzer
+ *
+ *  Records the arrival time of every report on the hidraw nodes of both G710+
+ *  interfaces, and the kernel timestamp and read time of every evdev frame.
+ *  Prints the distribution of report intervals, the estimated polling
+ *  interval, jitter and evdev delivery lag per interface, and flags what
+ *  looks like a degraded polling interval (e.g. behind a slow hub).
+ *
+ *  The samples can be written to a capture file and analyzed later, and the
+ *  tool can drive a virtual G710+ itself to check the analysis offline.
+ *  With -s it sets each of the given polling intervals through the
+ *  poll_interval_ms attribute of hid-lg-g710-plus in turn and records once
+ *  per interval, to compare the resulting latency. The driver rebinds the
+ *  interface to apply an interval, the new nodes are opened each time.
+ *
+ *  Usage: g710-jitter [-t seconds] [-e expected_interval_us] [-w capture] [-r capture]
+ *                     [-u interval_us] [-s ms,ms,...] [hid device ...]
+ *    -w  also write the samples to a capture file
+ *    -r  analyze a capture file instead of recording
+ *    -u  record a virtual G710+ that sends a report every interval_us
+ *    -s  compare the given polling intervals (keep typing while it runs)
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/input.h>
+
+#include "g710-uhid.h"
+
+#define MAX_IFACES 8
+#define MAX_NODES (MAX_IFACES * 4)
+#define G710_SYSFS_PREFIX "0003:046D:C24D."
+
+/* interval histogram buckets in us, the last one is open ended */
+static const long buckets_us[] = { 250, 500, 1000, 2000, 4000, 8000, 16000, 32000 };
+#define N_BUCKETS (sizeof(buckets_us) / sizeof(buckets_us[0]) + 1)
+
+struct samples {
+    long long *v;
+    long n, capacity;
+};
+
+struct iface {
+    char name[64];
+    char usb_interface[PATH_MAX]; /* sysfs directory of the usb interface, stays across a rebind */
+    int rebinding;
+    long long last_report_ns;
+    struct samples intervals; /* between consecutive hidraw reports, ns */
+    struct samples lag; /* evdev read time minus event timestamp, ns */
+    long reports, frames;
+};
+
+struct node {
+    int fd;
+    int evdev;
+    struct iface *iface;
+};
+
+static struct iface ifaces[MAX_IFACES];
+static int n_ifaces;
+static struct node nodes[MAX_NODES];
+static int n_nodes;
+static FILE *capture;
+
+static struct g710_uhid uhid;
+static volatile int uhid_running;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void samples_add(struct samples *s, long long value)
+{
+    if (s->n == s->capacity) {
+        s->capacity = s->capacity ? s->capacity * 2 : 1024;
+        s->v = realloc(s->v, s->capacity * sizeof(long long));
+        if (s->v == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    s->v[s->n++] = value;
+}
+
+static struct iface *iface_get(const char *name)
+{
+    int i;
+
+    for (i = 0; i < n_ifaces; i++) {
+        if (strcmp(ifaces[i].name, name) == 0)
+            return &ifaces[i];
+    }
+    if (n_ifaces == MAX_IFACES)
+        return NULL;
+    snprintf(ifaces[n_ifaces].name, sizeof(ifaces[n_ifaces].name), "%s", name);
+    return &ifaces[n_ifaces++];
+}
+
+static void record_report(struct iface *iface, long long time_ns, int report_id, int len)
+{
+    if (iface->reports > 0)
+        samples_add(&iface->intervals, time_ns - iface->last_report_ns);
+    iface->last_report_ns = time_ns;
+    iface->reports++;
+    if (capture != NULL)
+        fprintf(capture, "H %s %lld %d %d\n", iface->name, time_ns, report_id, len);
+}
+
+static void record_frame(struct iface *iface, long long event_ns, long long read_ns)
+{
+    samples_add(&iface->lag, read_ns - event_ns);
+    iface->frames++;
+    if (capture != NULL)
+        fprintf(capture, "E %s %lld %lld\n", iface->name, event_ns, read_ns);
+}
+
+static void add_node(const char *path, int evdev, struct iface *iface)
+{
+    int fd, clock = CLOCK_MONOTONIC;
+
+    if (n_nodes == MAX_NODES)
+        return;
+    fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+        return;
+    }
+    if (evdev)
+        ioctl(fd, EVIOCSCLOCKID, &clock);
+    nodes[n_nodes].fd = fd;
+    nodes[n_nodes].evdev = evdev;
+    nodes[n_nodes].iface = iface;
+    n_nodes++;
+}
+
+/* Opens the hidraw node and all event nodes of one hid device, e.g. 0003:046D:C24D.0001 */
+static void open_device(const char *name)
+{
+    char path[PATH_MAX], dev[PATH_MAX];
+    struct dirent *entry, *event;
+    struct iface *iface;
+    DIR *dir, *events;
+
+    iface = iface_get(name);
+    if (iface == NULL)
+        return;
+    snprintf(path, sizeof(path), "/sys/bus/hid/devices/%s/..", name);
+    if (realpath(path, iface->usb_interface) == NULL)
+        iface->usb_interface[0] = '\0';
+
+    snprintf(path, sizeof(path), "/sys/bus/hid/devices/%s/hidraw", name);
+    dir = opendir(path);
+    if (dir != NULL) {
+        while ((entry = readdir(dir)) != NULL) {
+            if (strncmp(entry->d_name, "hidraw", 6) != 0)
+                continue;
+            snprintf(dev, sizeof(dev), "/dev/%s", entry->d_name);
+            add_node(dev, 0, iface);
+        }
+        closedir(dir);
+    }
+
+    snprintf(path, sizeof(path), "/sys/bus/hid/devices/%s/input", name);
+    dir = opendir(path);
+    if (dir == NULL)
+        return;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "input", 5) != 0)
+            continue;
+        snprintf(path, sizeof(path), "/sys/bus/hid/devices/%s/input/%s", name, entry->d_name);
+        events = opendir(path);
+        if (events == NULL)
+            continue;
+        while ((event = readdir(events)) != NULL) {
+            if (strncmp(event->d_name, "event", 5) != 0)
+                continue;
+            snprintf(dev, sizeof(dev), "/dev/input/%s", event->d_name);
+            add_node(dev, 1, iface);
+        }
+        closedir(events);
+    }
+    closedir(dir);
+}
+
+static void open_all_devices(void)
+{
+    struct dirent *entry;
+    DIR *dir;
+
+    dir = opendir("/sys/bus/hid/devices");
+    if (dir == NULL) {
+        perror("/sys/bus/hid/devices");
+        return;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, G710_SYSFS_PREFIX, strlen(G710_SYSFS_PREFIX)) == 0)
+            open_device(entry->d_name);
+    }
+    closedir(dir);
+}
+
+static void read_node(struct node *node)
+{
+    unsigned char report[64];
+    struct input_event ev[64];
+    long long read_ns;
+    int n, i;
+
+    if (!node->evdev) {
+        while ((n = read(node->fd, report, sizeof(report))) > 0)
+            record_report(node->iface, now_ns(), report[0], n);
+        return;
+    }
+
+    while ((n = read(node->fd, ev, sizeof(ev))) > 0) {
+        read_ns = now_ns();
+        for (i = 0; i < n / (int)sizeof(ev[0]); i++) {
+            if (ev[i].type == EV_SYN && ev[i].code == SYN_REPORT)
+                record_frame(node->iface, ev[i].input_event_sec * 1000000000LL + ev[i].input_event_usec * 1000LL, read_ns);
+        }
+    }
+}
+
+static void record(int seconds)
+{
+    struct pollfd pfd[MAX_NODES];
+    long long end = now_ns() + seconds * 1000000000LL;
+    int i;
+
+    for (i = 0; i < n_nodes; i++) {
+        pfd[i].fd = nodes[i].fd;
+        pfd[i].events = POLLIN;
+    }
+
+    while (now_ns() < end) {
+        if (poll(pfd, n_nodes, 100) <= 0)
+            continue;
+        for (i = 0; i < n_nodes; i++) {
+            if (pfd[i].revents & POLLIN)
+                read_node(&nodes[i]);
+        }
+    }
+}
+
+static int load_capture(const char *path)
+{
+    char line[256], name[64];
+    long long a, b;
+    struct iface *iface;
+    int id, len;
+    FILE *f;
+
+    f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (sscanf(line, "H %63s %lld %d %d", name, &a, &id, &len) == 4) {
+            iface = iface_get(name);
+            if (iface != NULL)
+                record_report(iface, a, id, len);
+        } else if (sscanf(line, "E %63s %lld %lld", name, &a, &b) == 3) {
+            iface = iface_get(name);
+            if (iface != NULL)
+                record_frame(iface, a, b);
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return x < y ? -1 : x > y;
+}
+
+static long long percentile(struct samples *s, int per_mille)
+{
+    return s->n ? s->v[s->n * per_mille / 1000 < s->n ? s->n * per_mille / 1000 : s->n - 1] : 0;
+}
+
+/*
+ * The keyboard only reports on changes, so intervals are multiples of the polling interval.
+ * The smallest interval that occurs repeatedly is the best estimate of it; single short
+ * intervals can come from two reports in the same frame of a hub
+ */
+static long long estimate_poll_interval(struct samples *s)
+{
+    long i, run = 0;
+
+    for (i = 1; i < s->n; i++) {
+        if (s->v[i] - s->v[i - 1] < s->v[i - 1] / 8 + 50000) {
+            if (++run >= 3 || s->n < 20)
+                return s->v[i - run];
+        } else {
+            run = 0;
+        }
+    }
+    return s->n ? s->v[0] : 0;
+}
+
+static void analyze(struct iface *iface, long long expected_ns)
+{
+    long hist[N_BUCKETS] = { 0 };
+    long long poll_ns, mean = 0, off_grid = 0, rem;
+    double var = 0;
+    size_t b;
+    long i;
+
+    printf("%s: %ld reports, %ld evdev frames\n", iface->name, iface->reports, iface->frames);
+
+    if (iface->intervals.n > 0) {
+        qsort(iface->intervals.v, iface->intervals.n, sizeof(long long), cmp_ll);
+        poll_ns = estimate_poll_interval(&iface->intervals);
+
+        for (i = 0; i < iface->intervals.n; i++) {
+            mean += iface->intervals.v[i];
+            for (b = 0; b < N_BUCKETS - 1 && iface->intervals.v[i] >= buckets_us[b] * 1000; b++)
+                ;
+            hist[b]++;
+            if (poll_ns > 0) {
+                rem = iface->intervals.v[i] % poll_ns;
+                if (rem > poll_ns / 4 && rem < poll_ns - poll_ns / 4)
+                    off_grid++;
+            }
+        }
+        mean /= iface->intervals.n;
+        for (i = 0; i < iface->intervals.n; i++)
+            var += (double)(iface->intervals.v[i] - mean) * (iface->intervals.v[i] - mean);
+        var /= iface->intervals.n;
+
+        printf("  interval: min %lld us, p50 %lld us, p99 %lld us, max %lld us, mean %lld us, stddev %.0f us\n",
+               iface->intervals.v[0] / 1000, percentile(&iface->intervals, 500) / 1000,
+               percentile(&iface->intervals, 990) / 1000, iface->intervals.v[iface->intervals.n - 1] / 1000,
+               mean / 1000, sqrt(var) / 1000);
+        printf("  estimated polling interval: %lld us (%.0f Hz)\n", poll_ns / 1000, poll_ns ? 1e9 / poll_ns : 0.0);
+        printf("  histogram:");
+        for (b = 0; b < N_BUCKETS; b++) {
+            if (b < N_BUCKETS - 1)
+                printf(" <%ldus:%ld", buckets_us[b], hist[b]);
+            else
+                printf(" >=%ldus:%ld", buckets_us[b - 1], hist[b]);
+        }
+        printf("\n");
+
+        if (poll_ns > expected_ns + expected_ns / 4 && iface->intervals.n >= 20)
+            printf("  ANOMALY: polling interval %lld us is longer than the expected %lld us\n",
+                   poll_ns / 1000, expected_ns / 1000);
+        if (off_grid * 20 > iface->intervals.n)
+            printf("  ANOMALY: %lld of %ld intervals are not a multiple of the polling interval\n",
+                   off_grid, iface->intervals.n);
+    }
+
+    if (iface->lag.n > 0) {
+        qsort(iface->lag.v, iface->lag.n, sizeof(long long), cmp_ll);
+        printf("  evdev lag: p50 %lld us, p99 %lld us, max %lld us\n",
+               percentile(&iface->lag, 500) / 1000, percentile(&iface->lag, 990) / 1000,
+               iface->lag.v[iface->lag.n - 1] / 1000);
+        if (percentile(&iface->lag, 990) > 2 * expected_ns)
+            printf("  ANOMALY: evdev delivery lag p99 exceeds two polling intervals\n");
+    }
+}
+
+static void reset_samples(void)
+{
+    int i;
+
+    for (i = 0; i < n_ifaces; i++) {
+        ifaces[i].intervals.n = 0;
+        ifaces[i].lag.n = 0;
+        ifaces[i].reports = 0;
+        ifaces[i].frames = 0;
+    }
+}
+
+static int set_poll_interval(const char *name, const char *interval_ms)
+{
+    char path[PATH_MAX];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "/sys/bus/hid/devices/%s/logitech-g710/poll_interval_ms", name);
+    f = fopen(path, "w");
+    if (f == NULL) {
+        fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fputs(interval_ms, f);
+    if (fclose(f)) {
+        fprintf(stderr, "%s: cannot set %s ms: %s\n", name, interval_ms, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* Waits for the hid device that replaces the one of a rebound interface and takes its name */
+static int wait_rebound(struct iface *iface)
+{
+    struct dirent *entry;
+    DIR *dir;
+    int tries, found = 0;
+
+    for (tries = 0; !found && tries < 100; tries++) {
+        usleep(50000);
+        dir = opendir(iface->usb_interface);
+        if (dir == NULL)
+            continue;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strncmp(entry->d_name, G710_SYSFS_PREFIX, strlen(G710_SYSFS_PREFIX)) == 0 &&
+                    strcmp(entry->d_name, iface->name) != 0) {
+                snprintf(iface->name, sizeof(iface->name), "%.63s", entry->d_name);
+                found = 1;
+                break;
+            }
+        }
+        closedir(dir);
+    }
+    return found ? 0 : -1;
+}
+
+/* Closes all nodes and opens them again once the interfaces that are rebinding are back */
+static void reopen_devices(void)
+{
+    int i;
+
+    for (i = 0; i < n_nodes; i++)
+        close(nodes[i].fd);
+    n_nodes = 0;
+
+    for (i = 0; i < n_ifaces; i++) {
+        if (ifaces[i].rebinding && wait_rebound(&ifaces[i]))
+            fprintf(stderr, "%s did not come back after the rebind\n", ifaces[i].name);
+        ifaces[i].rebinding = 0;
+    }
+    usleep(500000); /* let the driver create its input devices */
+    for (i = 0; i < n_ifaces; i++)
+        open_device(ifaces[i].name);
+}
+
+/* Records once per polling interval in the comma separated list and analyzes each run */
+static void sweep(char *intervals, int seconds)
+{
+    char *interval;
+    int i;
+
+    for (interval = strtok(intervals, ","); interval != NULL; interval = strtok(NULL, ",")) {
+        for (i = 0; i < n_ifaces; i++)
+            ifaces[i].rebinding = set_poll_interval(ifaces[i].name, interval) == 0;
+        reopen_devices();
+        reset_samples();
+        printf("== poll_interval_ms %s\n", interval);
+        fflush(stdout);
+        record(seconds);
+        for (i = 0; i < n_ifaces; i++)
+            analyze(&ifaces[i], atol(interval) * 1000000LL);
+    }
+    for (i = 0; i < n_ifaces; i++)
+        set_poll_interval(ifaces[i].name, "0");
+}
+
+static void *uhid_pump_thread(void *arg)
+{
+    while (uhid_running && g710_uhid_pump(&uhid) >= 0)
+        ;
+    return NULL;
+}
+
+static void *uhid_send_thread(void *arg)
+{
+    long interval_us = *(long *)arg;
+    struct timespec next;
+    long i;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (i = 0; uhid_running; i++) {
+        next.tv_nsec += interval_us * 1000;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        g710_uhid_send_keys(&uhid, (i & 1) ? 0 : G710_KEY_G1);
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    const char *capture_path = NULL, *replay_path = NULL;
+    char *sweep_intervals = NULL;
+    long expected_us = 1000, uhid_interval_us = 0;
+    pthread_t pump, sender;
+    char name[64];
+    int seconds = 10, opt, i, ret;
+
+    while ((opt = getopt(argc, argv, "t:e:w:r:u:s:")) != -1) {
+        switch (opt) {
+            case 't': seconds = atoi(optarg); break;
+            case 'e': expected_us = atol(optarg); break;
+            case 'w': capture_path = optarg; break;
+            case 'r': replay_path = optarg; break;
+            case 'u': uhid_interval_us = atol(optarg); break;
+            case 's': sweep_intervals = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-t seconds] [-e expected_interval_us] [-w capture] [-r capture] "
+                        "[-u interval_us] [-s ms,ms,...] [hid device ...]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if (replay_path != NULL) {
+        if (load_capture(replay_path))
+            return 1;
+    } else {
+        if (capture_path != NULL) {
+            capture = fopen(capture_path, "w");
+            if (capture == NULL) {
+                fprintf(stderr, "cannot open %s: %s\n", capture_path, strerror(errno));
+                return 1;
+            }
+        }
+
+        if (uhid_interval_us > 0) {
+            ret = g710_uhid_create(&uhid, "Logitech G710+ (uhid jitter)");
+            if (ret == 0)
+                ret = g710_uhid_wait_started(&uhid, 5000);
+            if (ret == 0)
+                ret = g710_uhid_sysfs_name(&uhid, name, sizeof(name));
+            if (ret) {
+                fprintf(stderr, "cannot create virtual device: %s\n", strerror(-ret));
+                return 1;
+            }
+            uhid_running = 1;
+            pthread_create(&pump, NULL, uhid_pump_thread, NULL);
+            usleep(500000); /* let the driver create its input devices */
+            open_device(name);
+            pthread_create(&sender, NULL, uhid_send_thread, &uhid_interval_us);
+        } else if (optind < argc) {
+            for (i = optind; i < argc; i++)
+                open_device(argv[i]);
+        } else {
+            open_all_devices();
+        }
+
+        if (n_nodes == 0) {
+            fprintf(stderr, "no hidraw or event nodes of a G710+ found\n");
+            return 1;
+        }
+        fprintf(stderr, "recording %d nodes for %d s\n", n_nodes, seconds);
+        if (sweep_intervals != NULL) {
+            sweep(sweep_intervals, seconds);
+            return 0;
+        }
+        record(seconds);
+
+        if (uhid_interval_us > 0) {
+            uhid_running = 0;
+            pthread_join(sender, NULL);
+            /* the pump thread may be blocked in read(), it goes away with the process */
+            g710_uhid_destroy(&uhid);
+        }
+        if (capture != NULL)
+            fclose(capture);
+    }
+
+    for (i = 0; i < n_ifaces; i++)
+        analyze(&ifaces[i], expected_us * 1000);
+    return 0;
+}
@@ -0,0 +1,359 @@
+/*
+ *  Logitech G710+ end-to-end input latency benchmark
+ *
+ *  Injects report 3 traffic through a virtual G710+ and reads the resulting
+ *  evdev stream in a separate thread. Reports the latency from the report
+ *  write to the consumer read (p50/p99/p99.9) and the maximum sustained
+ *  report rate, once on an idle machine and once with all CPUs busy.
+ *  Results are printed as JSON so runs on different driver versions and
+ *  kernel configurations can be compared.
+ *
+ *  Usage: g710-latency-bench [-n samples] [-i interval_us] [-t seconds] [-l load_threads] [-b]
+ *    -b  busy-poll the event device instead of waiting in epoll
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/input.h>
+
+#include "g710-uhid.h"
+
+#define TEST_KEY KEY_F17 /* G1 */
+#define BITS_PER_LONG (sizeof(long) * 8)
+#define TEST_BIT(bit, array) ((array[(bit) / BITS_PER_LONG] >> ((bit) % BITS_PER_LONG)) & 1)
+
+struct phase {
+    const char *load;
+    long long *send_ns;
+    long long *recv_ns;
+    int *recv_value; /* key state of each received event, to pair it with the report that caused it */
+    long capacity; /* number of entries in send_ns/recv_ns/recv_value */
+    volatile long received;
+    volatile long dropped;
+    volatile int done;
+};
+
+static struct g710_uhid dev;
+static int evdev_fd = -1;
+static int busy_poll;
+static volatile int load_running;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void *pump_thread(void *arg)
+{
+    while (g710_uhid_pump(&dev) >= 0)
+        ;
+    return NULL;
+}
+
+static void *load_thread(void *arg)
+{
+    volatile unsigned long spin = 0;
+    while (load_running)
+        spin++;
+    return NULL;
+}
+
+/* Finds the event node of the virtual device that reports the G-keys */
+static int open_evdev(void)
+{
+    char name[64], path[PATH_MAX];
+    unsigned long keybits[KEY_MAX / BITS_PER_LONG + 1];
+    struct dirent *input, *event;
+    DIR *inputs, *events;
+    int fd, tries;
+
+    if (g710_uhid_sysfs_name(&dev, name, sizeof(name)))
+        return -1;
+
+    for (tries = 0; tries < 50; tries++, usleep(100000)) {
+        snprintf(path, sizeof(path), "/sys/bus/hid/devices/%s/input", name);
+        inputs = opendir(path);
+        if (inputs == NULL)
+            continue;
+        while ((input = readdir(inputs)) != NULL) {
+            if (strncmp(input->d_name, "input", 5) != 0)
+                continue;
+            snprintf(path, sizeof(path), "/sys/bus/hid/devices/%s/input/%s", name, input->d_name);
+            events = opendir(path);
+            if (events == NULL)
+                continue;
+            while ((event = readdir(events)) != NULL) {
+                if (strncmp(event->d_name, "event", 5) != 0)
+                    continue;
+                snprintf(path, sizeof(path), "/dev/input/%s", event->d_name);
+                fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+                if (fd < 0)
+                    continue;
+                memset(keybits, 0, sizeof(keybits));
+                ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keybits)), keybits);
+                if (TEST_BIT(TEST_KEY, keybits)) {
+                    closedir(events);
+                    closedir(inputs);
+                    return fd;
+                }
+                close(fd);
+            }
+            closedir(events);
+        }
+        closedir(inputs);
+    }
+    return -1;
+}
+
+static void *reader_thread(void *arg)
+{
+    struct phase *phase = arg;
+    struct input_event ev[64];
+    struct epoll_event ready;
+    int epfd = -1, i, n;
+    long long ts;
+
+    if (!busy_poll) {
+        struct epoll_event interest = { .events = EPOLLIN };
+        epfd = epoll_create1(EPOLL_CLOEXEC);
+        epoll_ctl(epfd, EPOLL_CTL_ADD, evdev_fd, &interest);
+    }
+
+    while (!phase->done) {
+        if (!busy_poll && epoll_wait(epfd, &ready, 1, 100) <= 0)
+            continue;
+        n = read(evdev_fd, ev, sizeof(ev));
+        if (n <= 0)
+            continue;
+        ts = now_ns();
+        for (i = 0; i < n / (int)sizeof(ev[0]); i++) {
+            if (ev[i].type == EV_SYN && ev[i].code == SYN_DROPPED)
+                phase->dropped++;
+            if (ev[i].type == EV_KEY && ev[i].code == TEST_KEY) {
+                if (phase->received < phase->capacity) {
+                    phase->recv_ns[phase->received] = ts;
+                    phase->recv_value[phase->received] = ev[i].value;
+                }
+                phase->received++;
+            }
+        }
+    }
+
+    if (epfd >= 0)
+        close(epfd);
+    return NULL;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Sample i presses G1 when even and releases it when odd */
+static int sent_value(long i)
+{
+    return !(i & 1);
+}
+
+/*
+ * Pairs every received event with the latest report of the same key state sent before it, so
+ * that a lost or extra event does not shift all later pairs. Returns the number of latencies
+ */
+static long pair_samples(const struct phase *phase, long samples, long long *latency, long *extra)
+{
+    long i, j, k = 0, valid = 0;
+    long received = phase->received < phase->capacity ? phase->received : phase->capacity;
+
+    *extra = 0;
+    for (i = 0; i < received; i++) {
+        for (j = k; j < samples && (sent_value(j) != phase->recv_value[i] ||
+                (j + 2 < samples && phase->send_ns[j + 2] <= phase->recv_ns[i])); j++)
+            ;
+        if (j == samples || phase->send_ns[j] > phase->recv_ns[i]) {
+            (*extra)++; /* no report could have caused it */
+            continue;
+        }
+        latency[valid++] = phase->recv_ns[i] - phase->send_ns[j];
+        k = j + 1;
+    }
+    return valid;
+}
+
+static void drain_evdev(void)
+{
+    struct input_event ev[64];
+    while (read(evdev_fd, ev, sizeof(ev)) > 0)
+        ;
+}
+
+static int run_phase(const char *load, int load_threads, long samples, long interval_us, int seconds, int first)
+{
+    struct phase phase = { .load = load, .capacity = samples };
+    struct phase flood = { .load = load };
+    pthread_t reader, *loaders = NULL;
+    struct timespec next;
+    long long *latency, start, elapsed;
+    long i, sent, valid, extra;
+    double rate;
+
+    phase.send_ns = calloc(samples, sizeof(long long));
+    phase.recv_ns = calloc(samples, sizeof(long long));
+    phase.recv_value = calloc(samples, sizeof(int));
+    latency = calloc(samples, sizeof(long long));
+    if (phase.send_ns == NULL || phase.recv_ns == NULL || phase.recv_value == NULL || latency == NULL)
+        return -ENOMEM;
+
+    if (load_threads > 0) {
+        loaders = calloc(load_threads, sizeof(pthread_t));
+        load_running = 1;
+        for (i = 0; i < load_threads; i++)
+            pthread_create(&loaders[i], NULL, load_thread, NULL);
+    }
+
+    /* latency: paced press/release reports, one key event each */
+    drain_evdev();
+    pthread_create(&reader, NULL, reader_thread, &phase);
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (i = 0; i < samples; i++) {
+        next.tv_nsec += interval_us * 1000;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        phase.send_ns[i] = now_ns();
+        g710_uhid_send_keys(&dev, sent_value(i) ? G710_KEY_G1 : 0);
+    }
+    usleep(100000);
+    phase.done = 1;
+    pthread_join(reader, NULL);
+
+    valid = pair_samples(&phase, samples, latency, &extra);
+    qsort(latency, valid, sizeof(long long), cmp_ll);
+
+    /* throughput: back to back reports, counted on the consumer side */
+    drain_evdev();
+    pthread_create(&reader, NULL, reader_thread, &flood);
+    start = now_ns();
+    for (sent = 0; now_ns() - start < seconds * 1000000000LL; sent++)
+        g710_uhid_send_keys(&dev, (sent & 1) ? 0 : G710_KEY_G1);
+    elapsed = now_ns() - start;
+    g710_uhid_send_keys(&dev, 0); /* the next phase starts with the key released */
+    usleep(100000);
+    flood.done = 1;
+    pthread_join(reader, NULL);
+    rate = flood.received * 1e9 / elapsed;
+
+    if (load_threads > 0) {
+        load_running = 0;
+        for (i = 0; i < load_threads; i++)
+            pthread_join(loaders[i], NULL);
+        free(loaders);
+    }
+
+    printf("%s    {\"load\": \"%s\", \"load_threads\": %d, \"samples\": %ld, \"lost\": %ld, \"extra\": %ld, "
+           "\"p50_ns\": %lld, \"p99_ns\": %lld, \"p999_ns\": %lld, \"max_ns\": %lld, "
+           "\"reports_sent\": %ld, \"reports_per_sec\": %.0f, \"dropped\": %ld}",
+           first ? "" : ",\n", load, load_threads, valid, samples - valid, extra,
+           valid ? latency[valid / 2] : 0,
+           valid ? latency[valid * 99 / 100] : 0,
+           valid ? latency[valid * 999 / 1000] : 0,
+           valid ? latency[valid - 1] : 0,
+           sent, rate, phase.dropped + flood.dropped);
+
+    free(phase.send_ns);
+    free(phase.recv_ns);
+    free(phase.recv_value);
+    free(latency);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    long samples = 10000, interval_us = 500;
+    int seconds = 2, load_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    char name[64], path[PATH_MAX], link[PATH_MAX];
+    struct utsname uts;
+    pthread_t pump;
+    ssize_t n;
+    int opt, ret;
+
+    while ((opt = getopt(argc, argv, "n:i:t:l:b")) != -1) {
+        switch (opt) {
+            case 'n': samples = atol(optarg); break;
+            case 'i': interval_us = atol(optarg); break;
+            case 't': seconds = atoi(optarg); break;
+            case 'l': load_threads = atoi(optarg); break;
+            case 'b': busy_poll = 1; break;
+            default:
+                fprintf(stderr, "usage: %s [-n samples] [-i interval_us] [-t seconds] [-l load_threads] [-b]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    ret = g710_uhid_create(&dev, "Logitech G710+ (uhid latency bench)");
+    if (ret) {
+        fprintf(stderr, "cannot create uhid device: %s\n", strerror(-ret));
+        return 1;
+    }
+    ret = g710_uhid_wait_started(&dev, 5000);
+    if (ret) {
+        fprintf(stderr, "device was not started: %s\n", strerror(-ret));
+        g710_uhid_destroy(&dev);
+        return 1;
+    }
+    pthread_create(&pump, NULL, pump_thread, NULL);
+
+    evdev_fd = open_evdev();
+    if (evdev_fd < 0) {
+        fprintf(stderr, "no event device with macro keys found, is a driver bound?\n");
+        g710_uhid_destroy(&dev);
+        return 1;
+    }
+    opt = CLOCK_MONOTONIC;
+    ioctl(evdev_fd, EVIOCSCLOCKID, &opt);
+
+    snprintf(link, sizeof(link), "none");
+    if (g710_uhid_sysfs_name(&dev, name, sizeof(name)) == 0) {
+        snprintf(path, sizeof(path), "/sys/bus/hid/devices/%s/driver", name);
+        n = readlink(path, link, sizeof(link) - 1);
+        link[n > 0 ? n : 0] = '\0';
+    }
+    uname(&uts);
+
+    printf("{\n  \"driver\": \"%s\",\n  \"kernel\": \"%s\",\n  \"mode\": \"%s\",\n"
+           "  \"interval_us\": %ld,\n  \"results\": [\n",
+           strrchr(link, '/') ? strrchr(link, '/') + 1 : link, uts.release,
+           busy_poll ? "busy-poll" : "epoll", interval_us);
+    run_phase("idle", 0, samples, interval_us, seconds, 1);
+    if (load_threads > 0)
+        run_phase("loaded", load_threads, samples, interval_us, seconds, 0);
+    printf("\n  ]\n}\n");
+
+    close(evdev_fd);
+    g710_uhid_destroy(&dev);
+    return 0;
+}
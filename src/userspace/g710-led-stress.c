@@ -0,0 +1,294 @@
+/*
+ *  Logitech G710+ sysfs led interface stress test
+ *
+ *  Binds hid-lg-g710-plus to a virtual G710+ and lets several threads read
+ *  and write led_macro and led_keys at the same time, like multiple tools
+ *  touching the backlight would. Reports throughput and latency percentiles
+ *  per attribute and operation, and counts accesses that failed or took
+ *  longer than the timeout. An access that is still blocked when the run is
+ *  over counts as hung once it exceeds the timeout, the report is printed
+ *  without waiting for it. Results are printed as JSON; the exit status is
+ *  non-zero when an access failed, timed out or hung, so the program can gate
+ *  locking changes in the driver.
+ *
+ *  Usage: g710-led-stress [-r readers] [-w writers] [-t seconds] [-T timeout_ms]
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "g710-uhid.h"
+
+enum { ATTR_LED_MACRO, ATTR_LED_KEYS, N_ATTRS };
+enum { OP_READ, OP_WRITE, N_OPS };
+
+static const char *attr_names[N_ATTRS] = { "led_macro", "led_keys" };
+static const char *op_names[N_OPS] = { "read", "write" };
+
+struct worker {
+    pthread_t thread;
+    pthread_mutex_t lock; /* held while a sample is added, main keeps it once the worker hung */
+    int op;
+    unsigned int seed;
+    long long busy_since; /* start of the access in progress, 0 between accesses */
+    int busy_attr;
+    int done;
+    long long *latency[N_ATTRS]; /* ns per access */
+    long count[N_ATTRS], capacity[N_ATTRS];
+    long errors[N_ATTRS], timeouts[N_ATTRS];
+};
+
+static struct g710_uhid dev;
+static char attr_paths[N_ATTRS][PATH_MAX];
+static volatile int running;
+static long long timeout_ns = 1000000000LL;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void *pump_thread(void *arg)
+{
+    while (g710_uhid_pump(&dev) >= 0)
+        ;
+    return NULL;
+}
+
+static int access_attr(struct worker *w, int attr)
+{
+    char buf[32];
+    int fd, len, ret = 0;
+
+    fd = open(attr_paths[attr], w->op == OP_READ ? O_RDONLY : O_WRONLY);
+    if (fd < 0)
+        return -errno;
+
+    if (w->op == OP_READ) {
+        if (read(fd, buf, sizeof(buf)) <= 0)
+            ret = -errno;
+    } else {
+        if (attr == ATTR_LED_MACRO)
+            len = snprintf(buf, sizeof(buf), "%d", rand_r(&w->seed) & 0xF);
+        else
+            len = snprintf(buf, sizeof(buf), "%d", (rand_r(&w->seed) % 5) << 4 | rand_r(&w->seed) % 5);
+        if (write(fd, buf, len) != len)
+            ret = -errno;
+    }
+    close(fd);
+    return ret;
+}
+
+static void *worker_thread(void *arg)
+{
+    struct worker *w = arg;
+    long long start, elapsed;
+    int attr, ret;
+
+    while (running) {
+        attr = rand_r(&w->seed) % N_ATTRS;
+        start = now_ns();
+        __atomic_store_n(&w->busy_attr, attr, __ATOMIC_RELAXED);
+        __atomic_store_n(&w->busy_since, start, __ATOMIC_RELEASE);
+        ret = access_attr(w, attr);
+        elapsed = now_ns() - start;
+        __atomic_store_n(&w->busy_since, 0, __ATOMIC_RELEASE);
+
+        pthread_mutex_lock(&w->lock);
+        if (ret)
+            w->errors[attr]++;
+        if (elapsed > timeout_ns)
+            w->timeouts[attr]++;
+
+        if (w->count[attr] == w->capacity[attr]) {
+            w->capacity[attr] = w->capacity[attr] ? w->capacity[attr] * 2 : 4096;
+            w->latency[attr] = realloc(w->latency[attr], w->capacity[attr] * sizeof(long long));
+            if (w->latency[attr] == NULL) {
+                perror("realloc");
+                exit(1);
+            }
+        }
+        w->latency[attr][w->count[attr]++] = elapsed;
+        pthread_mutex_unlock(&w->lock);
+    }
+    __atomic_store_n(&w->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/*
+ * Stops the workers. Waits until each one has finished or has been in the same access for
+ * longer than the timeout; such a worker counts as hung and is left blocked, because joining
+ * it could take forever. Returns the number of hung workers
+ */
+static int stop_workers(struct worker *workers, int n_workers)
+{
+    struct worker *w;
+    long long since;
+    int i, waiting, hung = 0;
+
+    running = 0;
+    do {
+        waiting = 0;
+        for (i = 0; i < n_workers; i++) {
+            w = &workers[i];
+            since = __atomic_load_n(&w->busy_since, __ATOMIC_ACQUIRE);
+            if (!__atomic_load_n(&w->done, __ATOMIC_ACQUIRE) && (since == 0 || now_ns() - since <= timeout_ns))
+                waiting = 1;
+        }
+        if (waiting)
+            usleep(10000);
+    } while (waiting);
+
+    for (i = 0; i < n_workers; i++) {
+        w = &workers[i];
+        /* not released: a hung worker that returns must not touch its samples during the report */
+        pthread_mutex_lock(&w->lock);
+        since = __atomic_load_n(&w->busy_since, __ATOMIC_ACQUIRE);
+        if (since != 0) {
+            fprintf(stderr, "%s of %s blocked for %lld ms\n", op_names[w->op],
+                    attr_names[w->busy_attr], (now_ns() - since) / 1000000);
+            w->timeouts[w->busy_attr]++;
+            hung++;
+        } else {
+            pthread_join(w->thread, NULL);
+        }
+    }
+    return hung;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Merges the samples of all workers doing op on attr and prints one JSON object */
+static long report(struct worker *workers, int n_workers, int op, int attr, int seconds, int first)
+{
+    long long *all;
+    long n = 0, errors = 0, timeouts = 0, i;
+    int w;
+
+    for (w = 0; w < n_workers; w++) {
+        if (workers[w].op == op)
+            n += workers[w].count[attr];
+    }
+    all = calloc(n ? n : 1, sizeof(long long));
+    if (all == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    for (n = 0, w = 0; w < n_workers; w++) {
+        if (workers[w].op != op)
+            continue;
+        for (i = 0; i < workers[w].count[attr]; i++)
+            all[n++] = workers[w].latency[attr][i];
+        errors += workers[w].errors[attr];
+        timeouts += workers[w].timeouts[attr];
+    }
+    qsort(all, n, sizeof(long long), cmp_ll);
+
+    printf("%s    {\"attribute\": \"%s\", \"op\": \"%s\", \"accesses\": %ld, \"per_sec\": %.0f, "
+           "\"p50_ns\": %lld, \"p99_ns\": %lld, \"p999_ns\": %lld, \"max_ns\": %lld, "
+           "\"errors\": %ld, \"timeouts\": %ld}",
+           first ? "" : ",\n", attr_names[attr], op_names[op], n, (double)n / seconds,
+           n ? all[n / 2] : 0, n ? all[n * 99 / 100] : 0, n ? all[n * 999 / 1000] : 0,
+           n ? all[n - 1] : 0, errors, timeouts);
+    free(all);
+    return errors + timeouts;
+}
+
+int main(int argc, char **argv)
+{
+    int readers = 4, writers = 2, seconds = 10, n_workers, i, op, attr, opt, ret, hung;
+    struct worker *workers;
+    pthread_t pump;
+    char name[64];
+    long failures = 0;
+
+    while ((opt = getopt(argc, argv, "r:w:t:T:")) != -1) {
+        switch (opt) {
+            case 'r': readers = atoi(optarg); break;
+            case 'w': writers = atoi(optarg); break;
+            case 't': seconds = atoi(optarg); break;
+            case 'T': timeout_ns = atol(optarg) * 1000000LL; break;
+            default:
+                fprintf(stderr, "usage: %s [-r readers] [-w writers] [-t seconds] [-T timeout_ms]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    ret = g710_uhid_create(&dev, "Logitech G710+ (uhid led stress)");
+    if (ret == 0)
+        ret = g710_uhid_wait_started(&dev, 5000);
+    if (ret) {
+        fprintf(stderr, "cannot create virtual device: %s\n", strerror(-ret));
+        return 1;
+    }
+    pthread_create(&pump, NULL, pump_thread, NULL);
+    usleep(500000); /* let the driver finish its probe */
+
+    if (g710_uhid_sysfs_name(&dev, name, sizeof(name))) {
+        fprintf(stderr, "virtual device not found in sysfs\n");
+        g710_uhid_destroy(&dev);
+        return 1;
+    }
+    for (attr = 0; attr < N_ATTRS; attr++) {
+        snprintf(attr_paths[attr], sizeof(attr_paths[attr]), "/sys/bus/hid/devices/%s/logitech-g710/%s",
+                 name, attr_names[attr]);
+        if (access(attr_paths[attr], F_OK)) {
+            fprintf(stderr, "%s missing, is hid-lg-g710-plus bound?\n", attr_paths[attr]);
+            g710_uhid_destroy(&dev);
+            return 1;
+        }
+    }
+
+    n_workers = readers + writers;
+    workers = calloc(n_workers, sizeof(struct worker));
+    if (workers == NULL)
+        return 1;
+
+    running = 1;
+    for (i = 0; i < n_workers; i++) {
+        workers[i].op = i < readers ? OP_READ : OP_WRITE;
+        workers[i].seed = i + 1;
+        pthread_mutex_init(&workers[i].lock, NULL);
+        pthread_create(&workers[i].thread, NULL, worker_thread, &workers[i]);
+    }
+    sleep(seconds);
+    hung = stop_workers(workers, n_workers);
+
+    printf("{\n  \"readers\": %d,\n  \"writers\": %d,\n  \"seconds\": %d,\n  \"timeout_ms\": %lld,\n  \"hung\": %d,\n"
+           "  \"results\": [\n", readers, writers, seconds, timeout_ns / 1000000, hung);
+    for (op = 0, i = 1; op < N_OPS; op++) {
+        for (attr = 0; attr < N_ATTRS; attr++) {
+            if ((op == OP_READ && readers == 0) || (op == OP_WRITE && writers == 0))
+                continue;
+            failures += report(workers, n_workers, op, attr, seconds, i);
+            i = 0;
+        }
+    }
+    printf("\n  ]\n}\n");
+
+    /* the pump thread may be blocked in read(), it goes away with the process, like hung workers */
+    g710_uhid_destroy(&dev);
+    return failures ? 1 : 0;
+}
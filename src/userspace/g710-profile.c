@@ -0,0 +1,261 @@
+/*
+ *  Logitech G710+ profile compiler
+ *
+ *  Turns a text profile into the binary format hid-lg-g710-plus loads from
+ *  /lib/firmware or from its profile sysfs file (see hid-lg-g710-plus.h).
+ *  Everything is checked here, so the driver only has to validate the blob.
+ *  One setting per line, # starts a comment, numbers may be decimal or hex:
+ *
+ *    remap <bank 1-3|all> <usage> <code>   key code for a HID keyboard usage
+ *    led_macro <mask>                      M1-MR leds, needs led_keys as well
+ *    led_keys <wasd> <keys>                backlight levels, 0-4
+ *    chord <mask> <code>                   G-key mask (G1 = 1, G2 = 2, ...)
+ *    tap_hold <g> <tap> <hold> <ms>        G-key 1-6
+ *    dim_timeout <s>                       0 disables dimming
+ *
+ *  Usage: g710-profile [-o output] [input]
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../kernel/hid-lg-g710-plus.h"
+
+#define BANKS 3
+#define USAGES 256
+#define G_KEYS 6
+#define CHORDS 64
+#define KEY_CNT 0x300
+
+static unsigned char blob[G710_PROFILE_MAX_SIZE];
+static size_t blob_size;
+
+static unsigned int remap[BANKS][USAGES];
+static int remap_banks; /* 0 no remap line, 1 only "all", 3 per bank */
+static int has_leds, led_macro, led_wasd, led_keys;
+static int chord_code[CHORDS];
+static int tap_code[G_KEYS], hold_code[G_KEYS], hold_ms[G_KEYS], has_tap_hold[G_KEYS];
+static int has_dim, dim_timeout;
+
+/* the keycodes the driver accepts: keys, no buttons */
+static int code_valid(long code)
+{
+    return (code >= 0 && code < 0x100) || (code >= 0x160 && code < 0x220) ||
+        (code > 0x223 && code < 0x2c0) || (code > 0x2e7 && code < KEY_CNT);
+}
+
+static int put_section(unsigned int type, const unsigned char *payload, size_t length)
+{
+    if (blob_size + sizeof(struct g710_profile_section) + length > sizeof(blob))
+        return -1;
+    blob[blob_size++] = type;
+    blob[blob_size++] = 0;
+    blob[blob_size++] = length & 0xFF;
+    blob[blob_size++] = length >> 8;
+    memcpy(blob + blob_size, payload, length);
+    blob_size += length;
+    return 0;
+}
+
+static void put_le16(unsigned char *p, unsigned int value)
+{
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+/* Parses the numbers of a line into values, returns how many were found */
+static int parse_numbers(char *args, long *values, int max)
+{
+    char *token, *end;
+    int n = 0;
+
+    for (token = strtok(args, " \t"); token != NULL; token = strtok(NULL, " \t")) {
+        if (n == max)
+            return -1;
+        values[n] = strtol(token, &end, 0);
+        if (*end != '\0')
+            return -1;
+        n++;
+    }
+    return n;
+}
+
+static int parse_line(char *line)
+{
+    char *keyword, *args, *bank;
+    long v[4];
+    int n, b;
+
+    line[strcspn(line, "#\r\n")] = '\0';
+    keyword = strtok(line, " \t");
+    if (keyword == NULL)
+        return 0;
+    args = strtok(NULL, "");
+    if (args == NULL)
+        args = "";
+
+    if (strcmp(keyword, "remap") == 0) {
+        bank = strtok(args, " \t");
+        if (bank == NULL || parse_numbers(strtok(NULL, ""), v, 2) != 2 ||
+                v[0] < 0 || v[0] >= USAGES || !code_valid(v[1]))
+            return -1;
+        if (strcmp(bank, "all") == 0) {
+            for (b = 0; b < BANKS; b++)
+                remap[b][v[0]] = v[1];
+            if (remap_banks == 0)
+                remap_banks = 1;
+        } else {
+            b = atoi(bank);
+            if (b < 1 || b > BANKS)
+                return -1;
+            remap[b - 1][v[0]] = v[1];
+            remap_banks = BANKS;
+        }
+    } else if (strcmp(keyword, "led_macro") == 0) {
+        if (parse_numbers(args, v, 1) != 1 || v[0] < 0 || v[0] > 0xF)
+            return -1;
+        led_macro = v[0];
+        has_leds |= 1;
+    } else if (strcmp(keyword, "led_keys") == 0) {
+        if (parse_numbers(args, v, 2) != 2 || v[0] < 0 || v[0] > 4 || v[1] < 0 || v[1] > 4)
+            return -1;
+        led_wasd = v[0];
+        led_keys = v[1];
+        has_leds |= 2;
+    } else if (strcmp(keyword, "chord") == 0) {
+        if (parse_numbers(args, v, 2) != 2 || v[0] < 1 || v[0] >= CHORDS || !code_valid(v[1]))
+            return -1;
+        chord_code[v[0]] = v[1];
+    } else if (strcmp(keyword, "tap_hold") == 0) {
+        n = parse_numbers(args, v, 4);
+        if (n != 4 || v[0] < 1 || v[0] > G_KEYS || !code_valid(v[1]) ||
+                !code_valid(v[2]) || v[3] < 0 || v[3] > 0xFFFF)
+            return -1;
+        tap_code[v[0] - 1] = v[1];
+        hold_code[v[0] - 1] = v[2];
+        hold_ms[v[0] - 1] = v[3];
+        has_tap_hold[v[0] - 1] = 1;
+    } else if (strcmp(keyword, "dim_timeout") == 0) {
+        if (parse_numbers(args, v, 1) != 1 || v[0] < 0 || v[0] > 0xFFFF)
+            return -1;
+        dim_timeout = v[0];
+        has_dim = 1;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static int build(void)
+{
+    static unsigned char payload[2 + BANKS * USAGES * 2];
+    int b, u, i, ret = 0;
+
+    memcpy(blob, G710_PROFILE_MAGIC, 4);
+    blob[4] = G710_PROFILE_VERSION;
+    blob_size = sizeof(struct g710_profile_header);
+
+    if (remap_banks) {
+        payload[0] = remap_banks;
+        payload[1] = 0;
+        for (b = 0; b < remap_banks; b++) {
+            for (u = 0; u < USAGES; u++)
+                put_le16(payload + 2 + (b * USAGES + u) * 2, remap[b][u]);
+        }
+        ret |= put_section(G710_PROFILE_REMAP, payload, 2 + remap_banks * USAGES * 2);
+    }
+    if (has_leds) {
+        payload[0] = led_macro;
+        payload[1] = led_wasd << 4 | led_keys;
+        ret |= put_section(G710_PROFILE_LEDS, payload, 2);
+    }
+    for (i = 1; i < CHORDS; i++) {
+        if (chord_code[i] == 0)
+            continue;
+        payload[0] = i;
+        payload[1] = 0;
+        put_le16(payload + 2, chord_code[i]);
+        ret |= put_section(G710_PROFILE_CHORD, payload, 4);
+    }
+    for (i = 0; i < G_KEYS; i++) {
+        if (!has_tap_hold[i])
+            continue;
+        payload[0] = i + 1;
+        payload[1] = 0;
+        put_le16(payload + 2, tap_code[i]);
+        put_le16(payload + 4, hold_code[i]);
+        put_le16(payload + 6, hold_ms[i]);
+        ret |= put_section(G710_PROFILE_TAP_HOLD, payload, 8);
+    }
+    if (has_dim) {
+        put_le16(payload, dim_timeout);
+        ret |= put_section(G710_PROFILE_DIM, payload, 2);
+    }
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    const char *output = NULL;
+    char line[512];
+    FILE *in = stdin, *out = stdout;
+    int opt, lineno = 0;
+
+    while ((opt = getopt(argc, argv, "o:")) != -1) {
+        switch (opt) {
+            case 'o': output = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-o output] [input]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if (optind < argc) {
+        in = fopen(argv[optind], "r");
+        if (in == NULL) {
+            fprintf(stderr, "cannot open %s: %s\n", argv[optind], strerror(errno));
+            return 1;
+        }
+    }
+    while (fgets(line, sizeof(line), in) != NULL) {
+        lineno++;
+        if (parse_line(line)) {
+            fprintf(stderr, "line %d: invalid setting\n", lineno);
+            return 1;
+        }
+    }
+
+    if (has_leds && has_leds != 3) {
+        fprintf(stderr, "led_macro and led_keys have to be set together\n");
+        return 1;
+    }
+    if (build()) {
+        fprintf(stderr, "profile larger than %d bytes\n", G710_PROFILE_MAX_SIZE);
+        return 1;
+    }
+
+    if (output != NULL) {
+        out = fopen(output, "wb");
+        if (out == NULL) {
+            fprintf(stderr, "cannot open %s: %s\n", output, strerror(errno));
+            return 1;
+        }
+    }
+    if (fwrite(blob, 1, blob_size, out) != blob_size || fclose(out)) {
+        fprintf(stderr, "write failed: %s\n", strerror(errno));
+        return 1;
+    }
+    return 0;
+}
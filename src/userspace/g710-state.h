@@ -0,0 +1,69 @@
+/*
+ *  Logitech G710+ state board
+ *
+ *  Layout of the POSIX shared memory segment published by g710-stated. The
+ *  daemon is the only writer; readers map G710_STATE_SHM read-only and copy
+ *  the state with g710_state_read(), which needs no system call. The segment
+ *  is protected by a seqlock: seq is odd while the daemon writes, readers
+ *  retry until they saw the same even value before and after copying.
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#ifndef G710_STATE_H
+#define G710_STATE_H
+
+#include <stdint.h>
+
+#define G710_STATE_SHM "/g710-plus-state"
+#define G710_STATE_MAGIC 0x47375354 /* "G7ST" */
+#define G710_STATE_VERSION 1
+
+struct g710_state {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seq; /* seqlock sequence, odd while the daemon writes */
+    uint32_t reserved;
+    uint64_t changes; /* number of published state changes */
+    uint8_t connected; /* a keyboard is bound to hid-lg-g710-plus */
+    uint8_t bank; /* bank selected with M1-M3, 0-2 */
+    uint8_t led_macro; /* M1-MR led bitmask */
+    uint8_t led_keys; /* wasd << 4 | keys backlight levels */
+    uint16_t keys; /* held macro keys, report 3 bitmap: M1-MR in bits 4-7, G1-G6 in bits 8-13 */
+    uint16_t reserved2;
+};
+
+/* Copies a consistent snapshot of the board into out */
+static inline void g710_state_read(const struct g710_state *board, struct g710_state *out)
+{
+    uint32_t seq;
+
+    for (;;) {
+        seq = __atomic_load_n(&board->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1)
+            continue;
+        out->magic = __atomic_load_n(&board->magic, __ATOMIC_RELAXED);
+        out->version = __atomic_load_n(&board->version, __ATOMIC_RELAXED);
+        out->changes = __atomic_load_n(&board->changes, __ATOMIC_RELAXED);
+        out->connected = __atomic_load_n(&board->connected, __ATOMIC_RELAXED);
+        out->bank = __atomic_load_n(&board->bank, __ATOMIC_RELAXED);
+        out->led_macro = __atomic_load_n(&board->led_macro, __ATOMIC_RELAXED);
+        out->led_keys = __atomic_load_n(&board->led_keys, __ATOMIC_RELAXED);
+        out->keys = __atomic_load_n(&board->keys, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&board->seq, __ATOMIC_RELAXED) == seq)
+            break;
+    }
+    out->seq = seq;
+    out->reserved = 0;
+    out->reserved2 = 0;
+}
+
+#endif
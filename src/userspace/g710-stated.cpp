@@ -0,0 +1,553 @@
+/*
+ *  Logitech G710+ state board daemon
+ *
+ *  Watches the keyboard once on behalf of every local consumer and publishes
+ *  the selected bank, the led state and the held macro keys in the shared
+ *  memory segment described in g710-state.h. Key changes are picked up from
+ *  the event devices of the keyboard, bank and led changes from the generic
+ *  netlink family of hid-lg-g710-plus. Readers map the segment and never
+ *  touch the device.
+ *
+ *  Usage: g710-stated [-f] [-r]
+ *    -f  stay in the foreground
+ *    -r  print the state from the segment once and exit
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/genetlink.h>
+#include <linux/input.h>
+#include <linux/netlink.h>
+
+#include "g710-state.h"
+#include "../kernel/hid-lg-g710-plus.h"
+
+namespace {
+
+const char *const hid_devices = "/sys/bus/hid/devices";
+const int rescan_ms = 2000;
+const uint16_t m_keys_shift = 4;
+const int banks = 3;
+
+volatile sig_atomic_t running = 1;
+
+void stop(int)
+{
+    running = 0;
+}
+
+/* The shared memory segment, written under its seqlock */
+class state_board {
+public:
+    ~state_board()
+    {
+        if (board_ != nullptr) {
+            munmap(board_, sizeof(g710_state));
+            shm_unlink(G710_STATE_SHM);
+        }
+    }
+
+    int create()
+    {
+        int fd = shm_open(G710_STATE_SHM, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return -errno;
+        if (ftruncate(fd, sizeof(g710_state)) < 0) {
+            close(fd);
+            return -errno;
+        }
+        void *map = mmap(nullptr, sizeof(g710_state), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED)
+            return -errno;
+
+        board_ = static_cast<g710_state *>(map);
+        std::memset(&state_, 0, sizeof(state_));
+        state_.magic = G710_STATE_MAGIC;
+        state_.version = G710_STATE_VERSION;
+        write(state_);
+        return 0;
+    }
+
+    /* The state readers see, as last published */
+    g710_state &state()
+    {
+        return state_;
+    }
+
+    /* Publishes state() if it differs from the segment */
+    void publish()
+    {
+        if (state_.connected == published_.connected && state_.bank == published_.bank &&
+                state_.led_macro == published_.led_macro && state_.led_keys == published_.led_keys &&
+                state_.keys == published_.keys)
+            return;
+        state_.changes++;
+        write(state_);
+    }
+
+private:
+    void write(const g710_state &state)
+    {
+        uint32_t seq = board_->seq;
+
+        __atomic_store_n(&board_->seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        __atomic_store_n(&board_->magic, state.magic, __ATOMIC_RELAXED);
+        __atomic_store_n(&board_->version, state.version, __ATOMIC_RELAXED);
+        __atomic_store_n(&board_->changes, state.changes, __ATOMIC_RELAXED);
+        __atomic_store_n(&board_->connected, state.connected, __ATOMIC_RELAXED);
+        __atomic_store_n(&board_->bank, state.bank, __ATOMIC_RELAXED);
+        __atomic_store_n(&board_->led_macro, state.led_macro, __ATOMIC_RELAXED);
+        __atomic_store_n(&board_->led_keys, state.led_keys, __ATOMIC_RELAXED);
+        __atomic_store_n(&board_->keys, state.keys, __ATOMIC_RELAXED);
+        __atomic_store_n(&board_->seq, seq + 2, __ATOMIC_RELEASE);
+        published_ = state;
+    }
+
+    g710_state *board_ = nullptr;
+    g710_state state_ {};
+    g710_state published_ {};
+};
+
+/* Subscription to the G710_GENL_MCGRP group, resolved through the generic netlink controller */
+class genl_watch {
+public:
+    ~genl_watch()
+    {
+        close_socket();
+    }
+
+    int fd() const
+    {
+        return fd_;
+    }
+
+    int open_socket()
+    {
+        close_socket();
+        fd_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_GENERIC);
+        if (fd_ < 0)
+            return -errno;
+
+        sockaddr_nl addr {};
+        addr.nl_family = AF_NETLINK;
+        if (bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || resolve() < 0 ||
+                setsockopt(fd_, SOL_NETLINK, NETLINK_ADD_MEMBERSHIP, &group_, sizeof(group_)) < 0) {
+            close_socket();
+            return -ENOENT;
+        }
+        return 0;
+    }
+
+    void close_socket()
+    {
+        if (fd_ >= 0)
+            close(fd_);
+        fd_ = -1;
+    }
+
+    /* Applies every pending message about device to state, returns -1 when the socket failed */
+    int receive(const std::string &device, g710_state &state)
+    {
+        char buf[8192];
+        ssize_t len;
+
+        while ((len = recv(fd_, buf, sizeof(buf), 0)) > 0) {
+            for (nlmsghdr *nlh = reinterpret_cast<nlmsghdr *>(buf); NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+                if (nlh->nlmsg_type == family_)
+                    apply(nlh, device, state);
+            }
+        }
+        return len < 0 && errno != EAGAIN && errno != ENOBUFS ? -1 : 0;
+    }
+
+private:
+    static nlattr *first_attr(void *payload)
+    {
+        return reinterpret_cast<nlattr *>(static_cast<char *>(payload));
+    }
+
+    static bool attr_ok(const nlattr *nla, int remaining)
+    {
+        return remaining >= static_cast<int>(sizeof(nlattr)) && nla->nla_len >= sizeof(nlattr) &&
+               nla->nla_len <= remaining;
+    }
+
+    static nlattr *next_attr(nlattr *nla, int &remaining)
+    {
+        int len = NLA_ALIGN(nla->nla_len);
+        remaining -= len;
+        return reinterpret_cast<nlattr *>(reinterpret_cast<char *>(nla) + len);
+    }
+
+    static void *attr_data(nlattr *nla)
+    {
+        return reinterpret_cast<char *>(nla) + NLA_HDRLEN;
+    }
+
+    void apply(nlmsghdr *nlh, const std::string &device, g710_state &state)
+    {
+        genlmsghdr *genl = static_cast<genlmsghdr *>(NLMSG_DATA(nlh));
+        int remaining = nlh->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+        bool ours = false;
+        int bank = -1, led_macro = -1, led_keys = -1;
+
+        if (genl->cmd != G710_CMD_STATE)
+            return;
+        for (nlattr *nla = first_attr(reinterpret_cast<char *>(genl) + GENL_HDRLEN); attr_ok(nla, remaining);
+                nla = next_attr(nla, remaining)) {
+            char *data = static_cast<char *>(attr_data(nla));
+            switch (nla->nla_type) {
+                case G710_ATTR_DEVICE: ours = device == std::string(data, strnlen(data, nla->nla_len - NLA_HDRLEN)); break;
+                case G710_ATTR_BANK: bank = *reinterpret_cast<uint8_t *>(data); break;
+                case G710_ATTR_LED_MACRO: led_macro = *reinterpret_cast<uint8_t *>(data); break;
+                case G710_ATTR_LED_KEYS: led_keys = *reinterpret_cast<uint8_t *>(data); break;
+            }
+        }
+        if (!ours)
+            return;
+        if (bank >= 0)
+            state.bank = bank;
+        if (led_macro >= 0)
+            state.led_macro = led_macro;
+        if (led_keys >= 0)
+            state.led_keys = led_keys;
+    }
+
+    /* Looks up the family id and the multicast group of G710_GENL_NAME */
+    int resolve()
+    {
+        struct {
+            nlmsghdr nlh;
+            genlmsghdr genl;
+            char attrs[64];
+        } req {};
+        char buf[4096];
+        nlattr *name = reinterpret_cast<nlattr *>(req.attrs);
+        ssize_t len;
+
+        name->nla_type = CTRL_ATTR_FAMILY_NAME;
+        name->nla_len = NLA_HDRLEN + sizeof(G710_GENL_NAME);
+        std::memcpy(attr_data(name), G710_GENL_NAME, sizeof(G710_GENL_NAME));
+        req.nlh.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN + NLA_ALIGN(name->nla_len));
+        req.nlh.nlmsg_type = GENL_ID_CTRL;
+        req.nlh.nlmsg_flags = NLM_F_REQUEST;
+        req.genl.cmd = CTRL_CMD_GETFAMILY;
+        req.genl.version = 1;
+
+        if (send(fd_, &req, req.nlh.nlmsg_len, 0) < 0)
+            return -1;
+        pollfd pfd = { fd_, POLLIN, 0 };
+        if (poll(&pfd, 1, 1000) <= 0 || (len = recv(fd_, buf, sizeof(buf), 0)) <= 0)
+            return -1;
+
+        nlmsghdr *nlh = reinterpret_cast<nlmsghdr *>(buf);
+        if (!NLMSG_OK(nlh, len) || nlh->nlmsg_type == NLMSG_ERROR)
+            return -1;
+
+        int remaining = nlh->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+        family_ = 0;
+        group_ = 0;
+        for (nlattr *nla = first_attr(static_cast<char *>(NLMSG_DATA(nlh)) + GENL_HDRLEN); attr_ok(nla, remaining);
+                nla = next_attr(nla, remaining)) {
+            if (nla->nla_type == CTRL_ATTR_FAMILY_ID)
+                family_ = *static_cast<uint16_t *>(attr_data(nla));
+            if ((nla->nla_type & NLA_TYPE_MASK) == CTRL_ATTR_MCAST_GROUPS)
+                find_group(nla);
+        }
+        return family_ != 0 && group_ != 0 ? 0 : -1;
+    }
+
+    void find_group(nlattr *groups)
+    {
+        int remaining = groups->nla_len - NLA_HDRLEN;
+        for (nlattr *grp = first_attr(attr_data(groups)); attr_ok(grp, remaining); grp = next_attr(grp, remaining)) {
+            int grp_remaining = grp->nla_len - NLA_HDRLEN;
+            uint32_t id = 0;
+            bool match = false;
+            for (nlattr *nla = first_attr(attr_data(grp)); attr_ok(nla, grp_remaining); nla = next_attr(nla, grp_remaining)) {
+                if (nla->nla_type == CTRL_ATTR_MCAST_GRP_ID)
+                    id = *static_cast<uint32_t *>(attr_data(nla));
+                if (nla->nla_type == CTRL_ATTR_MCAST_GRP_NAME)
+                    match = std::strcmp(static_cast<char *>(attr_data(nla)), G710_GENL_MCGRP) == 0;
+            }
+            if (match)
+                group_ = id;
+        }
+    }
+
+    int fd_ = -1;
+    uint16_t family_ = 0;
+    uint32_t group_ = 0;
+};
+
+/* The interface of a bound keyboard that reports the macro keys, with its event devices */
+class keyboard {
+public:
+    ~keyboard()
+    {
+        release();
+    }
+
+    const std::string &name() const
+    {
+        return name_;
+    }
+
+    const std::vector<int> &event_fds() const
+    {
+        return event_fds_;
+    }
+
+    bool bound() const
+    {
+        return !name_.empty();
+    }
+
+    /* Finds the keyboard and reads its current state into state */
+    bool find(g710_state &state)
+    {
+        DIR *devices = opendir(hid_devices);
+        if (devices == nullptr)
+            return false;
+
+        for (dirent *entry; (entry = readdir(devices)) != nullptr; ) {
+            std::string dir = std::string(hid_devices) + "/" + entry->d_name;
+            uint16_t keys;
+            if (entry->d_name[0] == '.' || read_keys(dir, keys) < 0)
+                continue;
+
+            name_ = entry->d_name;
+            dir_ = dir;
+            state.keys = keys;
+            state.led_macro = read_number(dir_ + "/logitech-g710/led_macro");
+            state.led_keys = read_number(dir_ + "/logitech-g710/led_keys");
+            open_events();
+            break;
+        }
+        closedir(devices);
+        return bound();
+    }
+
+    void release()
+    {
+        for (int fd : event_fds_)
+            close(fd);
+        event_fds_.clear();
+        name_.clear();
+        dir_.clear();
+    }
+
+    /*
+     * Drains the event devices and rereads the held keys, which are published by the driver
+     * with a generation counter. Returns -1 when the keyboard is gone
+     */
+    int update(g710_state &state)
+    {
+        input_event ev[64];
+        uint16_t keys;
+
+        for (int fd : event_fds_) {
+            ssize_t len;
+            while ((len = read(fd, ev, sizeof(ev))) > 0)
+                ;
+            if (len < 0 && errno == ENODEV)
+                return -1;
+        }
+        if (read_keys(dir_, keys) < 0)
+            return -1;
+
+        /* the driver selects the bank with the last M1-M3 press, the same rule applies here */
+        uint16_t pressed = keys & ~state.keys;
+        for (int bank = 0; bank < banks; bank++) {
+            if (pressed & 1 << (bank + m_keys_shift))
+                state.bank = bank;
+        }
+        state.keys = keys;
+        return 0;
+    }
+
+private:
+    static int read_keys(const std::string &dir, uint16_t &keys)
+    {
+        unsigned long long generation;
+        unsigned int value;
+        char buf[64];
+
+        if (read_file(dir + "/logitech-g710/keys", buf, sizeof(buf)) < 0 ||
+                std::sscanf(buf, "%llu %x", &generation, &value) != 2)
+            return -1;
+        keys = value;
+        return 0;
+    }
+
+    static int read_number(const std::string &path)
+    {
+        char buf[32];
+        return read_file(path, buf, sizeof(buf)) < 0 ? 0 : std::atoi(buf);
+    }
+
+    static int read_file(const std::string &path, char *buf, size_t size)
+    {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return -1;
+        ssize_t len = read(fd, buf, size - 1);
+        close(fd);
+        if (len <= 0)
+            return -1;
+        buf[len] = '\0';
+        return 0;
+    }
+
+    void open_events()
+    {
+        std::string inputs = dir_ + "/input";
+        DIR *dir = opendir(inputs.c_str());
+        if (dir == nullptr)
+            return;
+        for (dirent *input; (input = readdir(dir)) != nullptr; ) {
+            if (std::strncmp(input->d_name, "input", 5) != 0)
+                continue;
+            std::string path = inputs + "/" + input->d_name;
+            DIR *events = opendir(path.c_str());
+            if (events == nullptr)
+                continue;
+            for (dirent *event; (event = readdir(events)) != nullptr; ) {
+                if (std::strncmp(event->d_name, "event", 5) != 0)
+                    continue;
+                int fd = open((std::string("/dev/input/") + event->d_name).c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+                if (fd >= 0)
+                    event_fds_.push_back(fd);
+            }
+            closedir(events);
+        }
+        closedir(dir);
+    }
+
+    std::string name_;
+    std::string dir_;
+    std::vector<int> event_fds_;
+};
+
+int print_state()
+{
+    int fd = shm_open(G710_STATE_SHM, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        std::fprintf(stderr, "cannot open %s: %s, is g710-stated running?\n", G710_STATE_SHM, std::strerror(errno));
+        return 1;
+    }
+    void *map = mmap(nullptr, sizeof(g710_state), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        std::fprintf(stderr, "cannot map %s: %s\n", G710_STATE_SHM, std::strerror(errno));
+        return 1;
+    }
+
+    g710_state state;
+    g710_state_read(static_cast<const g710_state *>(map), &state);
+    if (state.magic != G710_STATE_MAGIC || state.version != G710_STATE_VERSION) {
+        std::fprintf(stderr, "%s: unknown layout\n", G710_STATE_SHM);
+        return 1;
+    }
+    std::printf("connected=%u bank=M%u led_macro=0x%x led_keys=0x%02x keys=0x%04x changes=%llu\n",
+                state.connected, state.bank + 1, state.led_macro, state.led_keys, state.keys,
+                static_cast<unsigned long long>(state.changes));
+    munmap(map, sizeof(g710_state));
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    bool foreground = false;
+    int opt, ret;
+
+    while ((opt = getopt(argc, argv, "fr")) != -1) {
+        switch (opt) {
+            case 'f': foreground = true; break;
+            case 'r': return print_state();
+            default:
+                std::fprintf(stderr, "usage: %s [-f] [-r]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    state_board board;
+    ret = board.create();
+    if (ret) {
+        std::fprintf(stderr, "cannot create %s: %s\n", G710_STATE_SHM, std::strerror(-ret));
+        return 1;
+    }
+    if (!foreground && daemon(0, 0) < 0) {
+        std::perror("daemon");
+        return 1;
+    }
+
+    struct sigaction sa {};
+    sa.sa_handler = stop;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    keyboard kbd;
+    genl_watch genl;
+    std::vector<pollfd> fds;
+
+    while (running) {
+        g710_state &state = board.state();
+        if (!kbd.bound()) {
+            if (kbd.find(state))
+                genl.open_socket();
+            state.connected = kbd.bound();
+            board.publish();
+        }
+
+        fds.clear();
+        for (int fd : kbd.event_fds())
+            fds.push_back({ fd, POLLIN, 0 });
+        if (genl.fd() >= 0)
+            fds.push_back({ genl.fd(), POLLIN, 0 });
+        /* without a keyboard, or without anything to wait on, look for it again later */
+        if (poll(fds.data(), fds.size(), kbd.bound() && !fds.empty() ? -1 : rescan_ms) < 0)
+            continue;
+
+        bool input = false;
+        for (const pollfd &pfd : fds) {
+            if (pfd.fd == genl.fd() && (pfd.revents & POLLIN) && genl.receive(kbd.name(), state) < 0)
+                genl.close_socket();
+            else if (pfd.fd != genl.fd() && pfd.revents != 0)
+                input = true;
+        }
+        if (input && kbd.update(state) < 0) {
+            kbd.release();
+            genl.close_socket();
+            state.connected = 0;
+            state.keys = 0;
+        }
+        board.publish();
+    }
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ *  Logitech G710+ per-report cost benchmark
+ *
+ *  Injects macro key reports into a virtual G710+ and measures how long the
+ *  kernel needs to process each of them. uhid hands UHID_INPUT2 to
+ *  hid_input_report() synchronously, so the write() time covers the whole
+ *  HID path: hid-lg-g710-plus, the HID-BPF program or hid-generic, whichever
+ *  is bound to the device.
+ *
+ *  Usage: g710-uhid-bench [-n reports] [-p module_parameter]
+ *    -p  run once with the given boolean parameter of hid-lg-g710-plus off, once on
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "g710-uhid.h"
+
+static volatile int running = 1;
+
+static void *pump_thread(void *arg)
+{
+    struct g710_uhid *dev = arg;
+    while (running && g710_uhid_pump(dev) >= 0)
+        ;
+    return NULL;
+}
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void bound_driver(struct g710_uhid *dev, char *buf, int len)
+{
+    char name[64], path[256], link[PATH_MAX];
+    ssize_t n;
+
+    snprintf(buf, len, "none");
+    if (g710_uhid_sysfs_name(dev, name, sizeof(name)))
+        return;
+    snprintf(path, sizeof(path), "/sys/bus/hid/devices/%s/driver", name);
+    n = readlink(path, link, sizeof(link) - 1);
+    if (n <= 0)
+        return;
+    link[n] = '\0';
+    snprintf(buf, len, "%.*s", len - 1, strrchr(link, '/') ? strrchr(link, '/') + 1 : link);
+}
+
+static int set_parameter(const char *param, const char *value)
+{
+    char path[256];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "/sys/module/hid_lg_g710_plus/parameters/%s", param);
+    f = fopen(path, "w");
+    if (f == NULL) {
+        fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fputs(value, f);
+    return fclose(f);
+}
+
+static void run(struct g710_uhid *dev, const char *driver, const char *label, int reports)
+{
+    long long start, elapsed;
+    int i, ret;
+
+    start = now_ns();
+    for (i = 0; i < reports; i++) {
+        ret = g710_uhid_send_keys(dev, (i & 1) ? 0 : G710_KEY_G1);
+        if (ret) {
+            fprintf(stderr, "write failed: %s\n", strerror(-ret));
+            break;
+        }
+    }
+    elapsed = now_ns() - start;
+
+    printf("driver=%s%s reports=%d total_ns=%lld ns_per_report=%.1f\n",
+           driver, label, i, elapsed, i ? (double)elapsed / i : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    struct g710_uhid dev;
+    pthread_t pump;
+    char driver[64], label[128];
+    const char *param = NULL;
+    int reports = 1000000;
+    int opt, ret;
+
+    while ((opt = getopt(argc, argv, "n:p:")) != -1) {
+        switch (opt) {
+            case 'n': reports = atoi(optarg); break;
+            case 'p': param = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-n reports] [-p module_parameter]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    ret = g710_uhid_create(&dev, "Logitech G710+ (uhid bench)");
+    if (ret) {
+        fprintf(stderr, "cannot create uhid device: %s\n", strerror(-ret));
+        return 1;
+    }
+
+    ret = g710_uhid_wait_started(&dev, 5000);
+    if (ret) {
+        fprintf(stderr, "device was not started: %s\n", strerror(-ret));
+        g710_uhid_destroy(&dev);
+        return 1;
+    }
+    pthread_create(&pump, NULL, pump_thread, &dev);
+    usleep(500000); /* let the driver finish its probe */
+    bound_driver(&dev, driver, sizeof(driver));
+
+    if (param == NULL) {
+        run(&dev, driver, "", reports);
+    } else {
+        /* compare a boolean parameter of the module, e.g. skip_generic_parsing */
+        if (set_parameter(param, "0") == 0) {
+            snprintf(label, sizeof(label), " %s=0", param);
+            run(&dev, driver, label, reports);
+        }
+        if (set_parameter(param, "1") == 0) {
+            snprintf(label, sizeof(label), " %s=1", param);
+            run(&dev, driver, label, reports);
+        }
+    }
+
+    /* the pump thread may be blocked in read(), it goes away with the process */
+    running = 0;
+    g710_uhid_destroy(&dev);
+    return 0;
+}
@@ -0,0 +1,247 @@
+/*
+ *  Logitech G710+ virtual device helpers
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/uhid.h>
+
+#include "g710-uhid.h"
+
+/*
+ * Report descriptor of the second G710+ interface, reduced to the reports the
+ * driver cares about: multimedia keys (2), macro keys (3) and the backlight
+ * feature reports (6, 8, 9). Sizes match info/feature_info.
+ */
+static const uint8_t g710_rdesc[] = {
+    0x05, 0x0c,       /* Usage Page (Consumer) */
+    0x09, 0x01,       /* Usage (Consumer Control) */
+    0xa1, 0x01,       /* Collection (Application) */
+    0x85, 0x02,       /*   Report ID (2) */
+    0x15, 0x00,       /*   Logical Minimum (0) */
+    0x26, 0x3c, 0x02, /*   Logical Maximum (572) */
+    0x19, 0x00,       /*   Usage Minimum (0) */
+    0x2a, 0x3c, 0x02, /*   Usage Maximum (572) */
+    0x75, 0x10,       /*   Report Size (16) */
+    0x95, 0x01,       /*   Report Count (1) */
+    0x81, 0x00,       /*   Input (Data,Array,Abs) */
+    0xc0,             /* End Collection */
+    0x06, 0x00, 0xff, /* Usage Page (Vendor 0xff00) */
+    0x09, 0x01,       /* Usage (1) */
+    0xa1, 0x01,       /* Collection (Application) */
+    0x85, 0x03,       /*   Report ID (3) */
+    0x15, 0x00,       /*   Logical Minimum (0) */
+    0x25, 0x01,       /*   Logical Maximum (1) */
+    0x19, 0x01,       /*   Usage Minimum (1) */
+    0x29, 0x18,       /*   Usage Maximum (24) */
+    0x75, 0x01,       /*   Report Size (1) */
+    0x95, 0x18,       /*   Report Count (24) */
+    0x81, 0x02,       /*   Input (Data,Var,Abs) */
+    0x85, 0x06,       /*   Report ID (6) */
+    0x09, 0x06,       /*   Usage (6) */
+    0x26, 0xff, 0x00, /*   Logical Maximum (255) */
+    0x75, 0x08,       /*   Report Size (8) */
+    0x95, 0x01,       /*   Report Count (1) */
+    0xb1, 0x02,       /*   Feature (Data,Var,Abs) */
+    0x85, 0x08,       /*   Report ID (8) */
+    0x09, 0x08,       /*   Usage (8) */
+    0x95, 0x03,       /*   Report Count (3) */
+    0xb1, 0x02,       /*   Feature (Data,Var,Abs) */
+    0x85, 0x09,       /*   Report ID (9) */
+    0x09, 0x09,       /*   Usage (9) */
+    0x95, 0x0c,       /*   Report Count (12) */
+    0xb1, 0x02,       /*   Feature (Data,Var,Abs) */
+    0xc0,             /* End Collection */
+};
+
+static int uhid_write(int fd, const struct uhid_event *ev)
+{
+    ssize_t ret = write(fd, ev, sizeof(*ev));
+    if (ret < 0)
+        return -errno;
+    return ret == sizeof(*ev) ? 0 : -EFAULT;
+}
+
+int g710_uhid_create(struct g710_uhid *dev, const char *name)
+{
+    struct uhid_event ev;
+    int ret;
+
+    memset(dev, 0, sizeof(*dev));
+    dev->led_macro_report[0] = 6;
+    dev->led_keys_report[0] = 8;
+
+    dev->fd = open("/dev/uhid", O_RDWR | O_CLOEXEC);
+    if (dev->fd < 0)
+        return -errno;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.type = UHID_CREATE2;
+    snprintf((char *)ev.u.create2.name, sizeof(ev.u.create2.name), "%s", name);
+    snprintf((char *)ev.u.create2.uniq, sizeof(ev.u.create2.uniq), "g710-uhid-%d", (int)getpid());
+    memcpy(ev.u.create2.rd_data, g710_rdesc, sizeof(g710_rdesc));
+    ev.u.create2.rd_size = sizeof(g710_rdesc);
+    ev.u.create2.bus = BUS_USB;
+    ev.u.create2.vendor = G710_VENDOR_ID;
+    ev.u.create2.product = G710_PRODUCT_ID;
+
+    ret = uhid_write(dev->fd, &ev);
+    if (ret) {
+        close(dev->fd);
+        dev->fd = -1;
+    }
+    return ret;
+}
+
+void g710_uhid_destroy(struct g710_uhid *dev)
+{
+    struct uhid_event ev;
+
+    if (dev->fd < 0)
+        return;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = UHID_DESTROY;
+    uhid_write(dev->fd, &ev);
+    close(dev->fd);
+    dev->fd = -1;
+}
+
+static int g710_uhid_get_report_reply(struct g710_uhid *dev, const struct uhid_event *req)
+{
+    struct uhid_event ev;
+    const uint8_t *data = NULL;
+    size_t size = 0;
+
+    switch (req->u.get_report.rnum) {
+        case 6: data = dev->led_macro_report; size = sizeof(dev->led_macro_report); break;
+        case 8: data = dev->led_keys_report; size = sizeof(dev->led_keys_report); break;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.type = UHID_GET_REPORT_REPLY;
+    ev.u.get_report_reply.id = req->u.get_report.id;
+    ev.u.get_report_reply.err = data ? 0 : EIO;
+    if (data) {
+        memcpy(ev.u.get_report_reply.data, data, size);
+        ev.u.get_report_reply.size = size;
+    }
+    return uhid_write(dev->fd, &ev);
+}
+
+static int g710_uhid_set_report_reply(struct g710_uhid *dev, const struct uhid_event *req)
+{
+    struct uhid_event ev;
+    const struct uhid_set_report_req *set = &req->u.set_report;
+
+    /* Remember the backlight state so that later GET_REPORTs see it */
+    if (set->rnum == 6 && set->size >= sizeof(dev->led_macro_report))
+        memcpy(dev->led_macro_report, set->data, sizeof(dev->led_macro_report));
+    if (set->rnum == 8 && set->size >= sizeof(dev->led_keys_report))
+        memcpy(dev->led_keys_report, set->data, sizeof(dev->led_keys_report));
+
+    memset(&ev, 0, sizeof(ev));
+    ev.type = UHID_SET_REPORT_REPLY;
+    ev.u.set_report_reply.id = set->id;
+    ev.u.set_report_reply.err = 0;
+    return uhid_write(dev->fd, &ev);
+}
+
+int g710_uhid_pump(struct g710_uhid *dev)
+{
+    struct uhid_event ev;
+    ssize_t ret;
+
+    ret = read(dev->fd, &ev, sizeof(ev));
+    if (ret < 0)
+        return -errno;
+
+    switch (ev.type) {
+        case UHID_START: dev->started = 1; break;
+        case UHID_STOP: dev->started = 0; break;
+        case UHID_OPEN: dev->opened = 1; break;
+        case UHID_CLOSE: dev->opened = 0; break;
+        case UHID_GET_REPORT: ret = g710_uhid_get_report_reply(dev, &ev); break;
+        case UHID_SET_REPORT: ret = g710_uhid_set_report_reply(dev, &ev); break;
+        default: ret = 0; break;
+    }
+    return ret < 0 ? ret : (int)ev.type;
+}
+
+int g710_uhid_wait_started(struct g710_uhid *dev, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = dev->fd, .events = POLLIN };
+    int ret;
+
+    while (!dev->started) {
+        ret = poll(&pfd, 1, timeout_ms);
+        if (ret < 0)
+            return -errno;
+        if (ret == 0)
+            return -ETIMEDOUT;
+        ret = g710_uhid_pump(dev);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
+int g710_uhid_send_keys(struct g710_uhid *dev, uint16_t keys)
+{
+    struct uhid_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.type = UHID_INPUT2;
+    ev.u.input2.size = 4;
+    ev.u.input2.data[0] = 3;
+    ev.u.input2.data[1] = keys >> 8;
+    ev.u.input2.data[2] = keys & 0xff;
+    ev.u.input2.data[3] = 0;
+    return uhid_write(dev->fd, &ev);
+}
+
+int g710_uhid_sysfs_name(struct g710_uhid *dev, char *buf, int len)
+{
+    char path[512], line[256], uniq[64];
+    struct dirent *entry;
+    DIR *dir;
+    FILE *f;
+    int found = 0;
+
+    snprintf(uniq, sizeof(uniq), "HID_UNIQ=g710-uhid-%d\n", (int)getpid());
+    dir = opendir("/sys/bus/hid/devices");
+    if (dir == NULL)
+        return -errno;
+
+    while (!found && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.')
+            continue;
+        snprintf(path, sizeof(path), "/sys/bus/hid/devices/%s/uevent", entry->d_name);
+        f = fopen(path, "r");
+        if (f == NULL)
+            continue;
+        while (fgets(line, sizeof(line), f) != NULL) {
+            if (strcmp(line, uniq) == 0) {
+                snprintf(buf, len, "%s", entry->d_name);
+                found = 1;
+                break;
+            }
+        }
+        fclose(f);
+    }
+    closedir(dir);
+    return found ? 0 : -ENOENT;
+}
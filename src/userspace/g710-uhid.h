@@ -0,0 +1,61 @@
+/*
+ *  Logitech G710+ virtual device helpers
+ *
+ *  Creates a uhid device with the vendor/product id of the G710+ so that
+ *  hid-lg-g710-plus (or the HID-BPF program) binds to it, and injects
+ *  macro key reports without the real hardware
+ *
+ *  Copyright (c) 2013 Filip Wieladke <Wattos@gmail.com>
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+
+#ifndef G710_UHID_H
+#define G710_UHID_H
+
+#include <stdint.h>
+
+#define G710_VENDOR_ID  0x046d
+#define G710_PRODUCT_ID 0xc24d
+
+/* Bits of the report 3 bitmap, same layout as g710_plus_key_map in the driver */
+#define G710_KEY_M1 (1 << 4)
+#define G710_KEY_M2 (1 << 5)
+#define G710_KEY_M3 (1 << 6)
+#define G710_KEY_MR (1 << 7)
+#define G710_KEY_G1 (1 << 8)
+#define G710_KEY_G2 (1 << 9)
+#define G710_KEY_G3 (1 << 10)
+#define G710_KEY_G4 (1 << 11)
+#define G710_KEY_G5 (1 << 12)
+#define G710_KEY_G6 (1 << 13)
+
+struct g710_uhid {
+    int fd;
+    int started; /* set once the kernel driver called hid_hw_start */
+    int opened; /* set while an input or hidraw reader has the device open */
+    uint8_t led_macro_report[2]; /* answers to GET_REPORT for report 6 */
+    uint8_t led_keys_report[4]; /* answers to GET_REPORT for report 8 */
+};
+
+int g710_uhid_create(struct g710_uhid *dev, const char *name);
+void g710_uhid_destroy(struct g710_uhid *dev);
+
+/* Handles one pending uhid event (answers GET/SET_REPORT). Returns the event type or -errno */
+int g710_uhid_pump(struct g710_uhid *dev);
+
+/* Pumps events until the driver started the device, or timeout_ms passed */
+int g710_uhid_wait_started(struct g710_uhid *dev, int timeout_ms);
+
+/* Sends a report 3 with the given key bitmap (G710_KEY_*) */
+int g710_uhid_send_keys(struct g710_uhid *dev, uint16_t keys);
+
+/* Returns the sysfs name of the hid device (e.g. 0003:046D:C24D.0008) in buf */
+int g710_uhid_sysfs_name(struct g710_uhid *dev, char *buf, int len);
+
+#endif